@@ -0,0 +1,128 @@
+#include <unistd.h>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <analysis_util.hpp>
+#include <decimation_util.hpp>
+#include <hwmondump_util.hpp>
+
+//
+// Microbenchmarks of hwmondump itself, to catch regressions before they
+// contaminate sensor measurements. Run with
+//   hwmondump_bench --reporter xml::out=bench_results.xml
+// (or make run_bench) to get machine-readable results.
+//
+
+/**
+ * temporary directory removed on destruction
+ */
+class BenchDir {
+ private:
+  std::filesystem::path path_;
+
+ public:
+  BenchDir() {
+    std::string tmpl =
+        (std::filesystem::temp_directory_path() / "hwmondump_bench_XXXXXX")
+            .string();
+    if (nullptr == mkdtemp(tmpl.data())) {
+      throw std::runtime_error("could not create temporary directory");
+    }
+    path_ = tmpl;
+  }
+
+  const std::filesystem::path& path() const { return path_; }
+
+  ~BenchDir() { std::filesystem::remove_all(path_); }
+};
+
+/**
+ * @returns synthetic recording: one access every 1000 ns, value changes every
+ * 100 accesses
+ */
+static time_reading_storage syntheticStorage(size_t size) {
+  time_reading_storage storage(size);
+  for (size_t i = 0; i < size; ++i) {
+    storage[i] = {1700000000000000000ull + i * 1000, double(42000 + i / 100)};
+  }
+  return storage;
+}
+
+TEST_CASE("readers") {
+  // content like a hwmon temperature attribute
+  BenchDir dir;
+  auto sensor = dir.path() / "temp1_input";
+  std::ofstream(sensor) << "42000\n";
+
+  BENCHMARK_ADVANCED("sysfs getvalue")(Catch::Benchmark::Chronometer meter) {
+    ReaderSysfs reader(sensor);
+    meter.measure([&] { return reader.getvalue(); });
+  };
+
+  BENCHMARK_ADVANCED("lseek getvalue")(Catch::Benchmark::Chronometer meter) {
+    ReaderLseek reader(sensor);
+    meter.measure([&] { return reader.getvalue(); });
+  };
+
+  BENCHMARK_ADVANCED("null getvalue")(Catch::Benchmark::Chronometer meter) {
+    ReaderNull reader(sensor);
+    meter.measure([&] { return reader.getvalue(); });
+  };
+
+  // best-case throughput of each access path, sampling loop inside the reader
+  time_reading_storage storage(1000);
+  BENCHMARK_ADVANCED("sysfs getbatch 1000")(Catch::Benchmark::Chronometer meter) {
+    ReaderSysfs reader(sensor);
+    meter.measure([&] { reader.getbatch(storage); });
+  };
+
+  BENCHMARK_ADVANCED("lseek getbatch 1000")(Catch::Benchmark::Chronometer meter) {
+    ReaderLseek reader(sensor);
+    meter.measure([&] { reader.getbatch(storage); });
+  };
+
+  BENCHMARK_ADVANCED("null getbatch 1000")(Catch::Benchmark::Chronometer meter) {
+    ReaderNull reader(sensor);
+    meter.measure([&] { reader.getbatch(storage); });
+  };
+
+  BENCHMARK("gettimestampnano") { return gettimestampnano(); };
+}
+
+TEST_CASE("postprocessing") {
+  auto size = GENERATE(1000, 100000, 1000000);
+  auto storage = syntheticStorage(size);
+
+  BENCHMARK("getvalueduration " + std::to_string(size)) {
+    return getvalueduration(storage);
+  };
+}
+
+TEST_CASE("output") {
+  auto size = GENERATE(1000, 100000);
+  auto storage = syntheticStorage(size);
+  BenchDir dir;
+
+  BENCHMARK("outputstorage " + std::to_string(size)) {
+    outputstorage(storage, dir.path() / "bench_timestamp_value.csv");
+  };
+}
+
+TEST_CASE("analysis") {
+  auto size = GENERATE(1000, 100000);
+  BenchDir dir;
+  auto path = dir.path() / "bench_timestamp_value.csv";
+  outputstorage(syntheticStorage(size), path);
+
+  BENCHMARK("ReadingFile " + std::to_string(size)) {
+    return ReadingFile(path).getMedian();
+  };
+
+  BENCHMARK("decimate lttb " + std::to_string(size)) {
+    return decimateFile(path, 500, "lttb");
+  };
+}
@@ -1,13 +1,211 @@
 #include <analysis_util.hpp>
 #include <argparse/argparse.hpp>
+#include <decimation_util.hpp>
+#include <hwmon_simulator.hpp>
 #include <libsensors_output_list.hpp>
 #include <hwmondump_util.hpp>
+#include <serve.hpp>
+#include <staleness.hpp>
+#include <survey.hpp>
+#include <watch.hpp>
 
 int main(int argc, char* argv[]) {
   argparse::ArgumentParser program("hwmondump");
 
   argparse::ArgumentParser list_command("list");
   list_command.add_description("list all available sensors");
+  list_command.add_argument("--hwmon-root")
+      .help(
+          "scan this directory (e.g. created by hwmondump simulate) for hwmon "
+          "chips instead of asking libsensors")
+      .metavar("DIR");
+  list_command.add_argument("--sysfs")
+      .help("scan /sys/class/hwmon directly instead of asking libsensors")
+      .flag();
+  list_command.add_argument("--values")
+      .help("also print the current value of every attribute (needs --sysfs "
+            "or --hwmon-root)")
+      .flag();
+  list_command.add_argument("--types")
+      .help("also print type and unit of every attribute (needs --sysfs or "
+            "--hwmon-root)")
+      .flag();
+
+  argparse::ArgumentParser simulate_command("simulate");
+  simulate_command.add_description(
+      "create a hwmon-like directory tree with changing values for testing "
+      "without sensors");
+  simulate_command.add_argument("DIR").help(
+      "directory to create the chips hwmon0, hwmon1, ... in, preferably on a "
+      "tmpfs like /dev/shm");
+  simulate_command.add_argument("--chips")
+      .help("number of simulated chips")
+      .scan<'d', int>()
+      .default_value(1)
+      .metavar("NUM");
+  simulate_command.add_argument("--interval-us")
+      .help("time between two value updates in microseconds")
+      .scan<'d', int>()
+      .default_value(10000)
+      .metavar("US");
+  simulate_command.add_argument("--pattern")
+      .help("how values change: constant, step, sine or random")
+      .default_value(std::string("step"))
+      .metavar("PATTERN");
+  simulate_command.add_argument("--duration")
+      .help("stop after SEC seconds instead of waiting for Ctrl-C")
+      .scan<'d', int>()
+      .metavar("SEC");
+
+  argparse::ArgumentParser survey_command("survey");
+  survey_command.add_description(
+      "benchmark every sensor for a short time and print access cost and "
+      "update interval as CSV");
+  survey_command.add_argument("--sysfs")
+      .help("use sysfs method")
+      .flag();
+  survey_command.add_argument("--sysfs-lseek")
+      .help("use lseek method (default: sysfs and lseek)")
+      .flag();
+  survey_command.add_argument("--libsensors")
+      .help("use libsensors method")
+      .flag();
+  survey_command.add_argument("--budget-ms")
+      .help("time to read each sensor with each method")
+      .scan<'d', int>()
+      .default_value(100)
+      .metavar("MS");
+  survey_command.add_argument("--jobs")
+      .help("survey up to NUM sensors on different buses at the same time, "
+            "each pinned to its own cpu")
+      .scan<'d', int>()
+      .default_value(1)
+      .metavar("NUM");
+  survey_command.add_argument("--attributes")
+      .help("comma separated glob patterns of the attributes to survey")
+      .default_value(std::string("*_input"))
+      .metavar("PATTERNS");
+  survey_command.add_argument("--hwmon-root")
+      .help("scan this directory for hwmon chips")
+      .default_value(std::string("/sys/class/hwmon"))
+      .metavar("DIR");
+  survey_command.add_argument("--from-libsensors")
+      .help("survey the sensors known to libsensors instead of scanning "
+            "--hwmon-root")
+      .flag();
+
+  argparse::ArgumentParser subscribe_command("subscribe");
+  subscribe_command.add_description(
+      "print the samples a running hwmondump record --shm publishes as CSV");
+  subscribe_command.add_argument("NAME").help(
+      "name of the shared memory ring given to record --shm");
+  subscribe_command.add_argument("--count")
+      .help("stop after NUM samples instead of when the recording finished")
+      .scan<'d', int>()
+      .metavar("NUM");
+  subscribe_command.add_argument("--interval-us")
+      .help("time to wait for new samples when the ring is drained")
+      .scan<'d', int>()
+      .default_value(1000)
+      .metavar("US");
+  subscribe_command.add_argument("--from-oldest")
+      .help("start with the oldest sample still in the ring instead of the "
+            "next one published")
+      .flag();
+
+  argparse::ArgumentParser serve_command("serve");
+  serve_command.add_description(
+      "read sensors in the background and answer any number of clients with "
+      "the cached values on a Unix domain socket");
+  serve_command.add_argument("SOCKET").help(
+      "path of the socket to create, e.g. /run/hwmondump.sock");
+  serve_command.add_argument("--sensor")
+      .help("serve this sensor, optionally at its own rate: PATH[@HZ] "
+            "(repeatable)")
+      .append()
+      .metavar("SPEC");
+  serve_command.add_argument("--attributes")
+      .help("serve all attributes below --hwmon-root matching the comma "
+            "separated glob patterns")
+      .metavar("PATTERNS");
+  serve_command.add_argument("--hwmon-root")
+      .help("with --attributes: scan this directory for hwmon chips")
+      .default_value(std::string("/sys/class/hwmon"))
+      .metavar("DIR");
+  serve_command.add_argument("--rate")
+      .help("reads per second of sensors without @HZ")
+      .scan<'d', int>()
+      .default_value(10)
+      .metavar("HZ");
+  serve_command.add_argument("--method")
+      .help("sysfs, lseek or auto (the cheaper of both per sensor)")
+      .default_value(std::string("auto"))
+      .metavar("METHOD");
+  serve_command.add_argument("--probe-ms")
+      .help("with --method auto: time to read each sensor with each method")
+      .scan<'d', int>()
+      .default_value(10)
+      .metavar("MS");
+  serve_command.add_argument("--max-clients")
+      .help("close further connections right away")
+      .scan<'d', int>()
+      .default_value(1024)
+      .metavar("NUM");
+  serve_command.add_argument("--duration")
+      .help("stop after SEC seconds instead of waiting for Ctrl-C")
+      .scan<'d', int>()
+      .metavar("SEC");
+
+  argparse::ArgumentParser query_command("query");
+  query_command.add_description(
+      "print the latest readings of a running hwmondump serve: path, value, "
+      "timestamp and age in ns");
+  query_command.add_argument("SOCKET").help("socket given to hwmondump serve");
+  query_command.add_argument("SENSOR")
+      .help("sensors to query (default: all)")
+      .nargs(argparse::nargs_pattern::any);
+  query_command.add_argument("--list")
+      .help("print path, method, rate, reads and errors of every sensor "
+            "instead")
+      .flag();
+
+  argparse::ArgumentParser watch_command("watch");
+  watch_command.add_description(
+      "print the values of sensors as they are read, until Ctrl-C, and the "
+      "overhead of doing so");
+  watch_command.add_argument("SENSOR")
+      .help("paths of the sensors to read")
+      .nargs(argparse::nargs_pattern::at_least_one);
+  watch_command.add_argument("--rate")
+      .help("read every sensor HZ times per second")
+      .scan<'d', int>()
+      .default_value(10)
+      .metavar("HZ");
+  watch_command.add_argument("--format")
+      .help("csv or json (one object per line)")
+      .default_value(std::string("csv"))
+      .metavar("FORMAT");
+  watch_command.add_argument("--changes-only")
+      .help("print a sample only if the value changed")
+      .flag();
+  watch_command.add_argument("--method")
+      .help("sysfs or lseek")
+      .default_value(std::string("lseek"))
+      .metavar("METHOD");
+  watch_command.add_argument("--flush-ms")
+      .help("write the output at most every MS milliseconds, 0 after every "
+            "round")
+      .scan<'d', int>()
+      .default_value(100)
+      .metavar("MS");
+  watch_command.add_argument("--count")
+      .help("stop after reading every sensor NUM times")
+      .scan<'d', int>()
+      .metavar("NUM");
+  watch_command.add_argument("--duration")
+      .help("stop after SEC seconds")
+      .scan<'d', int>()
+      .metavar("SEC");
 
   argparse::ArgumentParser about_command("about");
   about_command.add_description("print information about hwmondump");
@@ -30,6 +228,27 @@ int main(int argc, char* argv[]) {
   analysis_command.add_argument("--csv-header")
       .help("print header for --csv and exit")
       .flag();
+  analysis_command.add_argument("--gaps")
+      .help(
+          "list the NUM largest gaps between sensor accesses per method, with "
+          "system counter deltas if recorded with --system-counters")
+      .scan<'d', int>()
+      .metavar("NUM");
+  analysis_command.add_argument("--staleness")
+      .help(
+          "compare when each method observed the value changes, for "
+          "recordings made with record --concurrent")
+      .flag();
+  analysis_command.add_argument("--decimate")
+      .help(
+          "reduce every timestamp_value and duration_value file to NUM points "
+          "for plotting, stored as *_decimated.csv")
+      .scan<'d', int>()
+      .metavar("NUM");
+  analysis_command.add_argument("--decimate-method")
+      .help("algorithm for --decimate: lttb or minmax")
+      .default_value(std::string("lttb"))
+      .metavar("METHOD");
 
   argparse::ArgumentParser record_command("record");
   record_command.add_description("access a sensor");
@@ -48,6 +267,47 @@ int main(int argc, char* argv[]) {
       .help("tests the speed of this program without accessing sensors")
       .flag();
 
+  record_command.add_argument("--poll")
+      .help(
+          "wait for change notifications (POLLPRI) before each read, reports "
+          "whether the attribute notifies")
+      .flag();
+
+  record_command.add_argument("--poll-timeout-ms")
+      .help("with --poll: read anyway after MS milliseconds without notification")
+      .scan<'d', int>()
+      .default_value(100)
+      .metavar("MS");
+
+  record_command.add_argument("--method")
+      .help("use the method of a reader plugin, hwmondump_NAME.so from "
+            "HWMONDUMP_PLUGIN_PATH or the plugin directory (repeatable)")
+      .append()
+      .metavar("NAME");
+
+  record_command.add_argument("--plugin")
+      .help("load a reader plugin, its method can then be used with --method "
+            "(repeatable)")
+      .append()
+      .metavar("FILE");
+
+  record_command.add_argument("--group")
+      .help(
+          "SENSOR is a chip directory: snapshot all attributes matching the "
+          "comma separated PATTERNS (e.g. 'temp*_input,power*_input') into one "
+          "row per timestamp")
+      .metavar("PATTERNS");
+
+  record_command.add_argument("--replay")
+      .help(
+          "replay the values of a recording, SENSOR is a "
+          "METHOD_timestamp_value.csv")
+      .flag();
+
+  record_command.add_argument("--replay-timing")
+      .help("with --replay: return values at their recorded times")
+      .flag();
+
   // optional parameters
   record_command.add_argument("-a", "--accessnum")
       .help("how often the sensor will be accessed, must be at least 10")
@@ -67,6 +327,100 @@ int main(int argc, char* argv[]) {
       .required()
       .default_value("./");
 
+  record_command.add_argument("--rate")
+      .help(
+          "access the sensor HZ times per second at fixed deadlines instead "
+          "of as fast as possible, reports wakeup lateness")
+      .scan<'d', int>()
+      .metavar("HZ");
+
+  record_command.add_argument("--rate-spin-us")
+      .help(
+          "with --rate: busy-wait the last US microseconds before each "
+          "deadline instead of sleeping")
+      .scan<'d', int>()
+      .metavar("US");
+
+  record_command.add_argument("--adaptive")
+      .help(
+          "learn when the sensor value changes and poll densely only around "
+          "predicted changes, sleeping in between")
+      .flag();
+
+  record_command.add_argument("--threads")
+      .help(
+          "read the sensor with N pinned threads at once, reports throughput "
+          "and per-thread latencies")
+      .scan<'d', int>()
+      .metavar("N");
+
+  record_command.add_argument("--derive")
+      .help(
+          "save power (energy*_input) or rate of change per second as "
+          "METHOD_derived.csv")
+      .flag();
+
+  record_command.add_argument("--derive-wrap")
+      .help("with --derive: value at which the energy counter wraps to 0")
+      .scan<'g', double>()
+      .metavar("VALUE");
+
+  record_command.add_argument("--summary-only")
+      .help(
+          "keep log-linear histograms of access time and value durations "
+          "instead of every sample, save only METHOD_histogram.csv and the "
+          "summary in metadata.toml")
+      .flag();
+
+  record_command.add_argument("--concurrent")
+      .help(
+          "run the selected methods at the same time on separate cpus instead "
+          "of one after another")
+      .flag();
+
+  record_command.add_argument("--load")
+      .help(
+          "run background load while recording: KIND:CPUS with KIND spin, "
+          "membw or syscall, e.g. spin:1-3 (repeatable)")
+      .append()
+      .metavar("KIND:CPUS");
+
+  record_command.add_argument("--no-perf-counters")
+      .help("do not count cpu events (cycles, cache misses, ...) via perf")
+      .flag();
+
+  record_command.add_argument("--phase-table")
+      .help(
+          "print wall time, cpu time and peak memory of every phase (always "
+          "stored in metadata.toml)")
+      .flag();
+
+  record_command.add_argument("--system-counters")
+      .help(
+          "snapshot context switches, interrupts and softirqs before and "
+          "after each measurement into METHOD_system_counters.csv")
+      .flag();
+
+  record_command.add_argument("--system-counters-interval")
+      .help(
+          "additionally sample system counters every MS milliseconds from a "
+          "side thread (implies --system-counters)")
+      .scan<'d', int>()
+      .metavar("MS");
+
+  record_command.add_argument("--shm")
+      .help(
+          "additionally publish every sample to the shared memory ring NAME "
+          "(/dev/shm/NAME) for live consumers like hwmondump subscribe")
+      .metavar("NAME");
+
+  record_command.add_argument("--shm-capacity")
+      .help("with --shm: number of samples the ring keeps, rounded up to a "
+            "power of two")
+      .scan<'d', int>()
+      .default_value(65536)
+      .metavar("NUM");
+
   record_command.add_argument("--no-metadata")
       .help("do not store metadata in metadata.toml")
       .flag();
@@ -75,6 +429,12 @@ int main(int argc, char* argv[]) {
   program.add_subparser(record_command);
   program.add_subparser(analysis_command);
   program.add_subparser(about_command);
+  program.add_subparser(simulate_command);
+  program.add_subparser(survey_command);
+  program.add_subparser(subscribe_command);
+  program.add_subparser(serve_command);
+  program.add_subparser(query_command);
+  program.add_subparser(watch_command);
 
   // true if no arguments were given
   if (argc <= 1) {
@@ -90,13 +450,63 @@ int main(int argc, char* argv[]) {
   }
 
   if (program.is_subcommand_used("list")) {
-    return printSensorList();
+    const bool values = list_command.get<bool>("--values");
+    const bool types = list_command.get<bool>("--types");
+    if (list_command.is_used("--hwmon-root") ||
+        list_command.get<bool>("--sysfs")) {
+      const std::string root = list_command.is_used("--hwmon-root")
+                                   ? list_command.get<std::string>("--hwmon-root")
+                                   : "/sys/class/hwmon";
+      try {
+        outputHwmonAttributes(scanHwmonTree(root, values), values, types);
+      } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return -1;
+      }
+      return 0;
+    }
+    if (values || types) {
+      std::cerr << "--values and --types need --sysfs or --hwmon-root\n";
+      return -1;
+    }
+    try {
+      return printSensorList();
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << "\n";
+      return -1;
+    }
+
+  } else if (program.is_subcommand_used("simulate")) {
+    return simulateSubcommand(simulate_command);
+
+  } else if (program.is_subcommand_used("survey")) {
+    return surveySubcommand(survey_command);
+
+  } else if (program.is_subcommand_used("subscribe")) {
+    return subscribeSubcommand(subscribe_command);
+
+  } else if (program.is_subcommand_used("serve")) {
+    return serveSubcommand(serve_command);
+
+  } else if (program.is_subcommand_used("query")) {
+    return querySubcommand(query_command);
+
+  } else if (program.is_subcommand_used("watch")) {
+    return watchSubcommand(watch_command);
 
   } else if (program.is_subcommand_used("record")) {
     return recordSubcommand(record_command);
 
   } else if (program.is_subcommand_used("analysis")) {
     if (analysis_command.is_used("--csv-header")) {
+      if (analysis_command.is_used("--gaps")) {
+        std::cout << gap_csv_header() << std::endl;
+        return 0;
+      }
+      if (analysis_command.is_used("--staleness")) {
+        std::cout << staleness_csv_header() << std::endl;
+        return 0;
+      }
       std::cout << ReadingsDirectory::csv_header() << std::endl;
       return 0;
     }
@@ -107,6 +517,15 @@ int main(int argc, char* argv[]) {
 
     if (analysis_command.is_used("--median")) {
       return startAnalysis(dir, as_csv);
+    } else if (analysis_command.is_used("--gaps")) {
+      return startGapAnalysis(dir, analysis_command.get<int>("--gaps"),
+                              as_csv);
+    } else if (analysis_command.is_used("--staleness")) {
+      return startStalenessAnalysis(dir, as_csv);
+    } else if (analysis_command.is_used("--decimate")) {
+      return startDecimation(
+          dir, analysis_command.get<int>("--decimate"),
+          analysis_command.get<std::string>("--decimate-method"));
     } else {
       throw std::runtime_error("missing analysis goal, see --help");
     }
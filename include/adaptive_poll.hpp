@@ -0,0 +1,258 @@
+#pragma once
+
+#include <errno.h>
+#include <time.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * change detection quality of one adaptive polling run
+ */
+struct AdaptiveSummary {
+  /// value changes seen
+  uint64_t changes = 0;
+  /// accesses performed
+  uint64_t polls = 0;
+  /// learned update period at the end of the run, 0 if not locked
+  uint64_t period_ns = 0;
+  /// time between the last poll with the old and the first with the new
+  /// value, for changes caught inside the polling window
+  uint64_t median_uncertainty_ns = 0;
+  uint64_t max_uncertainty_ns = 0;
+  /// changes which already happened when waking up (window too late)
+  uint64_t late_wakeups = 0;
+  /// times the lock was lost and the period had to be learned again
+  uint64_t relocks = 0;
+};
+
+/**
+ * Polls a sensor densely only around its predicted value changes.
+ *
+ * Until the update period is known, every access follows the previous one
+ * immediately (learning). Value changes are detected online by comparing
+ * consecutive values, like getvalueduration() does afterwards. Sensors often
+ * update without changing their value, so intervals between changes are
+ * multiples of the period: the period is the shortest of the recent
+ * intervals once it occurred twice and all others are close to a multiple of
+ * it.
+ *
+ * When locked, the poller sleeps until one window before the next predicted
+ * change and polls densely until the change is seen or the window passed. The
+ * window widens after late wakeups and shrinks while predictions hit. The
+ * lock is dropped if a change happens off the predicted grid or many windows
+ * pass without any change.
+ *
+ * The learned state is kept across run() calls.
+ */
+class AdaptivePoller {
+ private:
+  /// intervals kept for learning and refining the period
+  static constexpr size_t history_size = 8;
+  /// windows in a row without change before the lock is dropped
+  static constexpr uint64_t max_empty_windows = 16;
+
+  uint64_t min_window_ns_;
+  uint64_t window_ns_;
+  uint64_t period_ns_ = 0;
+  uint64_t last_change_ns_ = 0;
+  std::vector<uint64_t> intervals_;
+
+  std::vector<uint64_t> uncertainties_;
+  AdaptiveSummary summary_;
+
+  static uint64_t now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  static void sleepUntil(uint64_t monotonic_ns) {
+    timespec ts = {.tv_sec = time_t(monotonic_ns / 1000000000),
+                   .tv_nsec = long(monotonic_ns % 1000000000)};
+    while (EINTR ==
+           clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr)) {
+    }
+  }
+
+  void unlock() {
+    period_ns_ = 0;
+    intervals_.clear();
+    window_ns_ = min_window_ns_;
+    ++summary_.relocks;
+  }
+
+  /// tries to find the period in the learned intervals
+  void learn(uint64_t interval) {
+    intervals_.push_back(interval);
+    if (intervals_.size() > history_size) {
+      intervals_.erase(intervals_.begin());
+    }
+    if (intervals_.size() < 3) {
+      return;
+    }
+
+    uint64_t candidate =
+        *std::min_element(intervals_.begin(), intervals_.end());
+    int single_periods = 0;
+    for (auto other : intervals_) {
+      double multiple = double(other) / candidate;
+      if (std::abs(multiple - std::round(multiple)) * candidate >
+          candidate / 10.0) {
+        // e.g. a change in the middle of two updates, forget the oldest
+        intervals_.erase(intervals_.begin());
+        return;
+      }
+      if (std::round(multiple) == 1) {
+        ++single_periods;
+      }
+    }
+    if (single_periods < 2) {
+      // a single short interval might be a delayed update followed by a
+      // punctual one, wait until it is confirmed (or shifted out)
+      return;
+    }
+
+    period_ns_ = candidate;
+    window_ns_ = std::max(min_window_ns_, period_ns_ / 10);
+    // keep only the normalized intervals for refining
+    for (auto& other : intervals_) {
+      other = other / std::llround(double(other) / candidate);
+    }
+  }
+
+  /// checks a change against the prediction and refines period and window
+  void track(uint64_t interval) {
+    uint64_t multiple =
+        std::max<int64_t>(std::llround(double(interval) / period_ns_), 1);
+    uint64_t expected = multiple * period_ns_;
+    uint64_t error =
+        interval > expected ? interval - expected : expected - interval;
+
+    if (error > window_ns_) {
+      unlock();
+      return;
+    }
+
+    intervals_.push_back(interval / multiple);
+    if (intervals_.size() > history_size) {
+      intervals_.erase(intervals_.begin());
+    }
+    auto sorted = intervals_;
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2,
+                     sorted.end());
+    period_ns_ = sorted[sorted.size() / 2];
+
+    // shrink slowly while predictions hit, but keep a margin over the error
+    window_ns_ = std::clamp<uint64_t>(
+        std::max(window_ns_ * 9 / 10, 4 * error), min_window_ns_,
+        std::max(min_window_ns_, period_ns_ / 2));
+  }
+
+  void onChange(uint64_t time, uint64_t previous_poll, bool woke_late) {
+    ++summary_.changes;
+
+    if (woke_late) {
+      // the change happened while sleeping, its time is unknown
+      ++summary_.late_wakeups;
+      window_ns_ =
+          std::max(min_window_ns_, std::min(window_ns_ * 2, period_ns_ / 2));
+      last_change_ns_ = 0;
+      return;
+    }
+    uncertainties_.push_back(time - previous_poll);
+
+    if (0 != last_change_ns_) {
+      if (0 == period_ns_) {
+        learn(time - last_change_ns_);
+      } else {
+        track(time - last_change_ns_);
+      }
+    }
+    last_change_ns_ = time;
+  }
+
+ public:
+  /**
+   * @param min_window_ns lower bound of the dense polling window on each
+   * side of a predicted change
+   */
+  AdaptivePoller(uint64_t min_window_ns = 20000)
+      : min_window_ns_(min_window_ns), window_ns_(min_window_ns) {}
+
+  bool locked() const { return period_ns_ > 0; }
+  uint64_t period_ns() const { return period_ns_; }
+  uint64_t window_ns() const { return window_ns_; }
+
+  /**
+   * calls access(i) for i in [0, count), which must return the read value,
+   * sleeping between predicted changes once the period is known
+   * @param time_limit_ns stop after this time, 0 for no limit
+   * @returns number of accesses performed
+   */
+  template <typename F>
+  size_t run(size_t count, uint64_t time_limit_ns, F&& access) {
+    summary_ = {};
+    uncertainties_.clear();
+
+    const uint64_t start = now();
+    const uint64_t end =
+        time_limit_ns > 0 ? start + time_limit_ns : UINT64_MAX;
+
+    bool have_value = false;
+    double last_value = 0;
+    uint64_t previous_poll = 0;
+    size_t i = 0;
+
+    for (; i < count; ++i) {
+      uint64_t time = now();
+      if (time >= end) {
+        break;
+      }
+
+      bool slept = false;
+      if (locked() && 0 != last_change_ns_) {
+        // next predicted change whose window has not passed yet
+        uint64_t expected = last_change_ns_ + period_ns_;
+        uint64_t empty_windows = 0;
+        if (time > expected + window_ns_) {
+          empty_windows = (time - expected - window_ns_) / period_ns_ + 1;
+          expected += empty_windows * period_ns_;
+        }
+
+        if (empty_windows > max_empty_windows) {
+          unlock();
+        } else if (time + window_ns_ < expected) {
+          sleepUntil(std::min(expected - window_ns_, end));
+          time = now();
+          slept = true;
+          if (time >= end) {
+            break;
+          }
+        }
+      }
+
+      double value = access(i);
+      if (have_value && value != last_value) {
+        onChange(time, previous_poll, slept);
+      }
+      have_value = true;
+      last_value = value;
+      previous_poll = time;
+    }
+
+    summary_.polls = i;
+    summary_.period_ns = period_ns_;
+    if (!uncertainties_.empty()) {
+      std::sort(uncertainties_.begin(), uncertainties_.end());
+      summary_.median_uncertainty_ns =
+          uncertainties_[uncertainties_.size() / 2];
+      summary_.max_uncertainty_ns = uncertainties_.back();
+    }
+    return i;
+  }
+
+  /// @returns statistics of the last run
+  const AdaptiveSummary& summary() const { return summary_; }
+};
@@ -1,13 +1,97 @@
+#pragma once
+
 #include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 #include <toml++/toml.hpp>
 
+/**
+ * counts the data rows (= lines without the header) of a csv file as written
+ * by outputstorage()
+ *
+ * only scans for line breaks, nothing is parsed -- this is much cheaper than
+ * the actual decimation pass
+ * @throws std::runtime_error if file can not be opened
+ */
+uint64_t countCsvRows(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::runtime_error("csv file not open: " + path.string());
+  }
+
+  std::vector<char> buffer(1 << 20);
+  uint64_t lines = 0;
+  char last = '\n';
+
+  while (file) {
+    file.read(buffer.data(), buffer.size());
+    std::streamsize got = file.gcount();
+    if (got <= 0) {
+      break;
+    }
+    lines += std::count(buffer.begin(), buffer.begin() + got, '\n');
+    last = buffer[got - 1];
+  }
+
+  // last line without trailing line break
+  if (last != '\n') {
+    ++lines;
+  }
+
+  // header does not count
+  return lines > 0 ? lines - 1 : 0;
+}
+
+/**
+ * reads a csv file as written by outputstorage() line by line and calls
+ * on_sample(row_index, sample) for every data row, header is skipped
+ * @throws std::runtime_error if file can not be opened or a row is malformed
+ */
+template <typename F>
+void forEachCsvSample(const std::filesystem::path& path, F&& on_sample) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("csv file not open: " + path.string());
+  }
+
+  uint64_t row = 0;
+  bool first = true;
+  for (std::string line; getline(file, line);) {
+    // skip header
+    if (first) {
+      first = false;
+      continue;
+    }
+
+    std::pair<uint64_t, double> sample;
+    const char* begin = line.data();
+    const char* end = line.data() + line.size();
+
+    auto [comma, ec_ts] = std::from_chars(begin, end, sample.first);
+    if (ec_ts != std::errc() || comma == end || *comma != ',') {
+      throw std::runtime_error("malformed line in " + path.string() + ": " +
+                               line);
+    }
+    auto [rest, ec_val] = std::from_chars(comma + 1, end, sample.second);
+    if (ec_val != std::errc()) {
+      throw std::runtime_error("malformed line in " + path.string() + ": " +
+                               line);
+    }
+
+    on_sample(row, sample);
+    ++row;
+  }
+}
+
 /**
  * Class that represents one file of a directory that contains
  * time-value-pairs in CSV format, as produced by outputstorage()
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * distribution of the time between consecutive accesses of one thread
+ */
+struct LatencySummary {
+  uint64_t median_ns = 0;
+  uint64_t p99_ns = 0;
+  uint64_t max_ns = 0;
+  double mean_ns = 0;
+};
+
+/**
+ * how often the value of a series of samples changed
+ */
+struct UpdateSummary {
+  uint64_t changes = 0;
+  /// median time between value changes, 0 for less than two changes
+  uint64_t median_interval_ns = 0;
+};
+
+/**
+ * @returns cpus this process may run on, in ascending order
+ * @throws std::runtime_error if the affinity can not be read
+ */
+static std::vector<int> allowedCpus() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (0 != sched_getaffinity(0, sizeof(set), &set)) {
+    throw std::runtime_error("could not read cpu affinity: " +
+                             std::string(strerror(errno)));
+  }
+
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+/**
+ * restricts the calling thread to one cpu
+ * @throws std::runtime_error if the affinity can not be set
+ */
+static void pinCurrentThread(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (0 != error) {
+    throw std::runtime_error("could not pin thread to cpu " +
+                             std::to_string(cpu) + ": " + strerror(error));
+  }
+}
+
+/**
+ * The latency of an access is the time from its timestamp to the timestamp of
+ * the next access, i.e. it includes storing the value.
+ *
+ * @param storage timestamp;value pairs of one thread
+ * @returns distribution of the access latencies, all 0 for less than 2
+ * accesses
+ */
+static LatencySummary accessLatencies(
+    const std::vector<std::pair<uint64_t, double>>& storage) {
+  LatencySummary result;
+  if (storage.size() < 2) {
+    return result;
+  }
+
+  std::vector<uint64_t> latencies;
+  latencies.reserve(storage.size() - 1);
+  double sum = 0;
+  for (size_t i = 1; i < storage.size(); ++i) {
+    latencies.push_back(storage[i].first - storage[i - 1].first);
+    sum += latencies.back();
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  result.median_ns = latencies[latencies.size() / 2];
+  result.p99_ns = latencies[(latencies.size() - 1) * 99 / 100];
+  result.max_ns = latencies.back();
+  result.mean_ns = sum / latencies.size();
+  return result;
+}
+
+/**
+ * @param storage timestamp;value pairs of one sensor
+ * @returns number of value changes and the median time between them, which
+ * is the observed update interval of the sensor
+ */
+static UpdateSummary valueUpdates(
+    const std::vector<std::pair<uint64_t, double>>& storage) {
+  UpdateSummary result;
+  std::vector<uint64_t> changes;
+  for (size_t i = 1; i < storage.size(); ++i) {
+    if (storage[i].second != storage[i - 1].second) {
+      changes.push_back(storage[i].first);
+    }
+  }
+  result.changes = changes.size();
+  if (changes.size() < 2) {
+    return result;
+  }
+
+  std::vector<uint64_t> intervals;
+  for (size_t i = 1; i < changes.size(); ++i) {
+    intervals.push_back(changes[i] - changes[i - 1]);
+  }
+  std::nth_element(intervals.begin(), intervals.begin() + intervals.size() / 2,
+                   intervals.end());
+  result.median_interval_ns = intervals[intervals.size() / 2];
+  return result;
+}
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <analysis_util.hpp>
+#include <hwmondump_util.hpp>
+
+static const std::string fname_suffix_decimated = "_decimated.csv";
+
+/**
+ * Min-max bucketing: splits all rows except the first and last one into
+ * equally sized buckets and keeps the minimum and maximum of each bucket (in
+ * their original order), so spikes always survive.
+ *
+ * Feed rows with push() in order, then collect the points with result().
+ * Produces at most target_points rows.
+ */
+class MinMaxDecimator {
+ private:
+  using sample_t = time_reading_storage::value_type;
+
+  struct Extreme {
+    uint64_t row;
+    sample_t sample;
+    double y;
+  };
+
+  uint64_t total_rows_;
+  uint64_t bucket_count_;
+  bool pass_through_;
+
+  uint64_t current_bucket_ = 0;
+  std::optional<Extreme> min_;
+  std::optional<Extreme> max_;
+
+  time_reading_storage result_;
+
+  void flushBucket() {
+    if (!min_) {
+      return;
+    }
+
+    if (min_->row == max_->row) {
+      result_.push_back(min_->sample);
+    } else if (min_->row < max_->row) {
+      result_.push_back(min_->sample);
+      result_.push_back(max_->sample);
+    } else {
+      result_.push_back(max_->sample);
+      result_.push_back(min_->sample);
+    }
+
+    min_.reset();
+    max_.reset();
+  }
+
+ public:
+  /**
+   * @param total_rows number of rows that will be pushed, see countCsvRows()
+   * @param target_points maximum number of points to keep, at least 4
+   */
+  MinMaxDecimator(uint64_t total_rows, uint64_t target_points)
+      : total_rows_(total_rows),
+        bucket_count_((target_points - 2) / 2),
+        pass_through_(total_rows <= target_points) {
+    if (target_points < 4) {
+      throw std::runtime_error("min-max decimation needs at least 4 points");
+    }
+  }
+
+  static const char* methodname() { return "minmax"; }
+
+  /**
+   * @param row index of sample in input, must be pushed in ascending order
+   * @param y value used to determine minimum and maximum
+   */
+  void push(uint64_t row, const sample_t& sample, double y) {
+    if (pass_through_ || 0 == row || total_rows_ - 1 == row) {
+      flushBucket();
+      result_.push_back(sample);
+      return;
+    }
+
+    // rows 1 .. total_rows - 2 are distributed across the buckets
+    uint64_t bucket = ((row - 1) * bucket_count_) / (total_rows_ - 2);
+    if (bucket != current_bucket_) {
+      flushBucket();
+      current_bucket_ = bucket;
+    }
+
+    if (!min_ || y < min_->y) {
+      min_ = Extreme{row, sample, y};
+    }
+    if (!max_ || y > max_->y) {
+      max_ = Extreme{row, sample, y};
+    }
+  }
+
+  /**
+   * @returns decimated series, call after all rows have been pushed
+   */
+  time_reading_storage result() {
+    flushBucket();
+    return result_;
+  }
+};
+
+/**
+ * Largest-Triangle-Three-Buckets (Steinarsson, 2013): keeps first and last
+ * row, and from every bucket in between the point which spans the largest
+ * triangle with the previously selected point and the average of the next
+ * bucket. Preserves the visual shape much better than plain striding.
+ *
+ * Streaming variant: only the current and the next bucket are buffered, so
+ * memory use is about 2 * total_rows / target_points samples.
+ */
+class LttbDecimator {
+ private:
+  using sample_t = time_reading_storage::value_type;
+
+  struct Point {
+    double x;
+    double y;
+    sample_t sample;
+  };
+
+  uint64_t total_rows_;
+  uint64_t bucket_count_;
+  bool pass_through_;
+
+  uint64_t current_bucket_ = 0;
+  std::vector<Point> current_;
+  std::vector<Point> next_;
+  std::optional<Point> selected_;
+  std::optional<Point> last_;
+
+  time_reading_storage result_;
+
+  /// picks the point of current_ spanning the largest triangle towards c
+  void selectFromCurrent(double c_x, double c_y) {
+    if (current_.empty()) {
+      return;
+    }
+
+    const Point& a = *selected_;
+    const Point* best = &current_.front();
+    double best_area = -1;
+
+    for (const auto& b : current_) {
+      double area =
+          std::abs((a.x - c_x) * (b.y - a.y) - (a.x - b.x) * (c_y - a.y));
+      if (area > best_area) {
+        best_area = area;
+        best = &b;
+      }
+    }
+
+    selected_ = *best;
+    result_.push_back(best->sample);
+  }
+
+  /// selects from current bucket using next bucket (or last point) as anchor
+  void advance() {
+    if (!next_.empty()) {
+      double sum_x = 0;
+      double sum_y = 0;
+      for (const auto& p : next_) {
+        sum_x += p.x;
+        sum_y += p.y;
+      }
+      selectFromCurrent(sum_x / next_.size(), sum_y / next_.size());
+    } else {
+      selectFromCurrent(last_->x, last_->y);
+    }
+
+    current_.swap(next_);
+    next_.clear();
+    ++current_bucket_;
+  }
+
+ public:
+  /**
+   * @param total_rows number of rows that will be pushed, see countCsvRows()
+   * @param target_points number of points to keep, at least 3
+   */
+  LttbDecimator(uint64_t total_rows, uint64_t target_points)
+      : total_rows_(total_rows),
+        bucket_count_(target_points - 2),
+        pass_through_(total_rows <= target_points) {
+    if (target_points < 3) {
+      throw std::runtime_error("LTTB decimation needs at least 3 points");
+    }
+  }
+
+  static const char* methodname() { return "lttb"; }
+
+  /**
+   * @param row index of sample in input, must be pushed in ascending order
+   * @param x position on horizontal axis (must be monotonic)
+   * @param y position on vertical axis
+   */
+  void push(uint64_t row, const sample_t& sample, double x, double y) {
+    if (pass_through_) {
+      result_.push_back(sample);
+      return;
+    }
+
+    if (0 == row) {
+      selected_ = Point{x, y, sample};
+      result_.push_back(sample);
+      return;
+    }
+
+    if (total_rows_ - 1 == row) {
+      last_ = Point{x, y, sample};
+      return;
+    }
+
+    uint64_t bucket = ((row - 1) * bucket_count_) / (total_rows_ - 2);
+    while (bucket > current_bucket_ + 1) {
+      advance();
+    }
+
+    if (bucket == current_bucket_) {
+      current_.push_back({x, y, sample});
+    } else {
+      next_.push_back({x, y, sample});
+    }
+  }
+
+  /**
+   * @returns decimated series, call after all rows have been pushed
+   * @throws std::runtime_error if fewer rows than announced were pushed
+   */
+  time_reading_storage result() {
+    if (pass_through_) {
+      return result_;
+    }
+
+    if (!selected_ || !last_) {
+      throw std::runtime_error(
+          "decimation input ended early, was the file modified?");
+    }
+
+    while (!current_.empty() || !next_.empty()) {
+      advance();
+    }
+
+    result_.push_back(last_->sample);
+    return result_;
+  }
+};
+
+/**
+ * decimates one csv file produced by hwmondump record
+ *
+ * for *_timestamp_value.csv the series is value over timestamp,
+ * for *_duration_value.csv the series is duration over row index
+ * (so spikes in the duration are kept)
+ *
+ * @param method one of "lttb" or "minmax"
+ * @returns decimated rows, same format as the input
+ */
+time_reading_storage decimateFile(const std::filesystem::path& path,
+                                  uint64_t target_points,
+                                  const std::string& method) {
+  const bool is_duration =
+      path.string().ends_with(fname_suffix_duration_value);
+  const uint64_t rows = countCsvRows(path);
+
+  if (LttbDecimator::methodname() == method) {
+    LttbDecimator decimator(rows, target_points);
+    std::optional<uint64_t> first_timestamp;
+
+    forEachCsvSample(path, [&](uint64_t row, const auto& sample) {
+      if (is_duration) {
+        decimator.push(row, sample, double(row), double(sample.first));
+        return;
+      }
+
+      if (!first_timestamp) {
+        first_timestamp = sample.first;
+      }
+      // relative timestamps, absolute ones exceed the precision of a double
+      decimator.push(row, sample, double(sample.first - *first_timestamp),
+                     sample.second);
+    });
+
+    return decimator.result();
+  }
+
+  if (MinMaxDecimator::methodname() == method) {
+    MinMaxDecimator decimator(rows, target_points);
+
+    forEachCsvSample(path, [&](uint64_t row, const auto& sample) {
+      decimator.push(row, sample,
+                     is_duration ? double(sample.first) : sample.second);
+    });
+
+    return decimator.result();
+  }
+
+  throw std::runtime_error("unknown decimation method: " + method);
+}
+
+/**
+ * decimates all timestamp_value and duration_value files in a directory,
+ * every result is stored next to its input with suffix _decimated.csv
+ *
+ * @returns 0 on success
+ * @returns -1 on failure
+ */
+int startDecimation(const std::filesystem::path& dir,
+                    int target_points,
+                    const std::string& method) {
+  if (LttbDecimator::methodname() != method &&
+      MinMaxDecimator::methodname() != method) {
+    std::cerr << "unknown decimation method " << method
+              << ", use lttb or minmax\n";
+    return -1;
+  }
+
+  if (target_points < 4) {
+    std::cerr << "number of points too small, please enter at least 4\n";
+    return -1;
+  }
+
+  std::vector<std::filesystem::path> inputs;
+
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const std::string fname = entry.path().string();
+    if (fname.ends_with(fname_suffix_timestamp_value) ||
+        fname.ends_with(fname_suffix_duration_value)) {
+      inputs.push_back(entry.path());
+    }
+  }
+
+  if (inputs.empty()) {
+    std::cerr << "No files to decimate, directory doesn't contain output "
+                 "files\n";
+    return -1;
+  }
+
+  std::sort(inputs.begin(), inputs.end());
+
+  try {
+    for (const auto& input : inputs) {
+      auto output = input;
+      output.replace_extension();
+      output += fname_suffix_decimated;
+      checkoutputfile(output);
+
+      auto decimated = decimateFile(input, target_points, method);
+      outputstorage(decimated, output);
+
+      std::cout << input.filename().string() << " -> "
+                << output.filename().string() << " (" << decimated.size()
+                << " points)\n";
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return -1;
+  }
+
+  return 0;
+}
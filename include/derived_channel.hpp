@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+static const std::string fname_suffix_derived = "_derived.csv";
+
+/**
+ * what a derived channel computes from the raw values
+ */
+enum class DerivedKind {
+  /// power in W from a cumulative energy counter in microjoule
+  power,
+  /// change of the raw value per second
+  rate,
+};
+
+/**
+ * Derives the rate of change of a sample stream online, one sample at a time.
+ *
+ * Sensors update less often than they are read, so the rate is computed
+ * between consecutive value changes only, at the timestamp of the change. The
+ * first change is the baseline, as the time of the update before it is
+ * unknown.
+ *
+ * Energy is a cumulative counter, so for power a decreasing value is a
+ * wraparound: with a known wrap value the delta is corrected, otherwise it is
+ * treated as a reset and the next change becomes the new baseline. Rates of
+ * other attributes (gauges like temperatures) are signed.
+ */
+class DerivedChannel {
+ private:
+  DerivedKind kind_;
+  double wrap_;
+
+  bool have_value_ = false;
+  double last_value_ = 0;
+  bool have_baseline_ = false;
+  uint64_t baseline_timestamp_ = 0;
+  double baseline_value_ = 0;
+
+  std::vector<std::pair<uint64_t, double>> samples_;
+  uint64_t wraps_ = 0;
+  uint64_t resets_ = 0;
+
+ public:
+  /**
+   * @param wrap value at which the energy counter wraps to 0, 0 if unknown,
+   * ignored for rates
+   */
+  DerivedChannel(DerivedKind kind, double wrap = 0)
+      : kind_(kind), wrap_(wrap) {}
+
+  /**
+   * @returns power for energy*_input attributes (hwmon reports microjoule),
+   * rate otherwise
+   */
+  static DerivedKind kindFor(const std::filesystem::path& sensor) {
+    std::string fname = sensor.filename();
+    return fname.starts_with("energy") ? DerivedKind::power
+                                       : DerivedKind::rate;
+  }
+
+  /// @returns column header of the derived values
+  std::string columnName() const {
+    return DerivedKind::power == kind_ ? "power_w" : "rate_per_s";
+  }
+
+  /**
+   * feeds the next raw sample
+   * @returns true if a derived sample was produced
+   */
+  bool push(uint64_t timestamp, double value) {
+    if (!have_value_ || value == last_value_) {
+      have_value_ = true;
+      last_value_ = value;
+      return false;
+    }
+    last_value_ = value;
+
+    if (!have_baseline_) {
+      have_baseline_ = true;
+      baseline_timestamp_ = timestamp;
+      baseline_value_ = value;
+      return false;
+    }
+
+    double delta = value - baseline_value_;
+    if (delta < 0 && DerivedKind::power == kind_) {
+      if (wrap_ <= 0) {
+        ++resets_;
+        have_baseline_ = false;
+        return false;
+      }
+      delta += wrap_;
+      ++wraps_;
+    }
+
+    // per nanosecond to per second
+    double rate = delta * 1e9 / (timestamp - baseline_timestamp_);
+    if (DerivedKind::power == kind_) {
+      rate /= 1e6;
+    }
+    samples_.emplace_back(timestamp, rate);
+
+    baseline_timestamp_ = timestamp;
+    baseline_value_ = value;
+    return true;
+  }
+
+  /// @returns derived samples so far
+  const std::vector<std::pair<uint64_t, double>>& samples() const {
+    return samples_;
+  }
+
+  /// @returns number of corrected wraparounds
+  uint64_t wraps() const { return wraps_; }
+
+  /// @returns number of decreasing energy values without known wrap value
+  uint64_t resets() const { return resets_; }
+
+  /**
+   * writes all derived samples
+   * @throws std::runtime_error if the file can not be written
+   */
+  void save(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+      throw std::runtime_error("could not open " + path.string());
+    }
+
+    file << "nanoseconds," << columnName() << "\n";
+    for (const auto& [timestamp, value] : samples_) {
+      file << std::fixed << timestamp << "," << value << "\n";
+    }
+  }
+};
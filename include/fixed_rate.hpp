@@ -0,0 +1,159 @@
+#pragma once
+
+#include <errno.h>
+#include <time.h>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const std::string fname_suffix_deadlines = "_deadlines.csv";
+
+/**
+ * wakeup accuracy of one fixed-rate run
+ */
+struct DeadlineSummary {
+  /// lateness of accesses after their deadline, in ns
+  uint64_t median_ns = 0;
+  uint64_t p99_ns = 0;
+  uint64_t max_ns = 0;
+  double mean_ns = 0;
+  /// deadlines skipped because the previous access ran past them
+  uint64_t missed = 0;
+};
+
+/**
+ * Performs accesses at absolute deadlines of a fixed rate instead of as fast
+ * as possible.
+ *
+ * Sleeps with clock_nanosleep() on CLOCK_MONOTONIC until shortly before each
+ * deadline and busy-waits the remaining spin time, so the CPU cost and the
+ * wakeup accuracy can be traded off. Deadlines do not drift: if an access
+ * runs past the next deadline(s), they are skipped and counted as missed
+ * instead of being caught up with a burst.
+ *
+ * Targets and actual access times of the last run are kept, converted to the
+ * time base of gettimestampnano().
+ */
+class FixedRateSchedule {
+ private:
+  uint64_t period_ns_;
+  uint64_t spin_ns_;
+
+  std::vector<uint64_t> targets_;
+  std::vector<uint64_t> actuals_;
+  uint64_t missed_ = 0;
+
+  static uint64_t now(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  static void sleepUntil(uint64_t monotonic_ns) {
+    timespec ts = {.tv_sec = time_t(monotonic_ns / 1000000000),
+                   .tv_nsec = long(monotonic_ns % 1000000000)};
+    while (EINTR ==
+           clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr)) {
+    }
+  }
+
+ public:
+  /**
+   * @param rate_hz accesses per second
+   * @param spin_ns busy-wait this long before each deadline instead of
+   * sleeping, 0 to rely on clock_nanosleep() only
+   * @throws std::runtime_error if rate is not positive
+   */
+  FixedRateSchedule(int rate_hz, uint64_t spin_ns)
+      : spin_ns_(spin_ns) {
+    if (rate_hz <= 0) {
+      throw std::runtime_error("rate must be positive");
+    }
+    period_ns_ = 1000000000ull / rate_hz;
+  }
+
+  uint64_t period_ns() const { return period_ns_; }
+  uint64_t spin_ns() const { return spin_ns_; }
+
+  /**
+   * calls access(i) for i in [0, count) at consecutive deadlines, the first
+   * one period after the call
+   */
+  template <typename F>
+  void run(int count, F&& access) {
+    targets_.clear();
+    actuals_.clear();
+    targets_.reserve(count);
+    actuals_.reserve(count);
+    missed_ = 0;
+
+    // to convert monotonic times to gettimestampnano() (realtime)
+    const int64_t offset = int64_t(now(CLOCK_REALTIME)) -
+                           int64_t(now(CLOCK_MONOTONIC));
+
+    uint64_t deadline = now(CLOCK_MONOTONIC) + period_ns_;
+    for (int i = 0; i < count; ++i) {
+      if (spin_ns_ < period_ns_) {
+        sleepUntil(deadline - spin_ns_);
+      }
+      uint64_t actual;
+      while ((actual = now(CLOCK_MONOTONIC)) < deadline) {
+      }
+
+      access(i);
+
+      targets_.push_back(deadline + offset);
+      actuals_.push_back(actual + offset);
+
+      deadline += period_ns_;
+      for (uint64_t done = now(CLOCK_MONOTONIC); deadline < done;
+           deadline += period_ns_) {
+        ++missed_;
+      }
+    }
+  }
+
+  /// @returns lateness statistics of the last run
+  DeadlineSummary summary() const {
+    DeadlineSummary result;
+    result.missed = missed_;
+    if (targets_.empty()) {
+      return result;
+    }
+
+    std::vector<uint64_t> lateness(targets_.size());
+    double sum = 0;
+    for (size_t i = 0; i < targets_.size(); ++i) {
+      lateness[i] = actuals_[i] - targets_[i];
+      sum += lateness[i];
+    }
+    std::sort(lateness.begin(), lateness.end());
+
+    result.median_ns = lateness[lateness.size() / 2];
+    result.p99_ns = lateness[(lateness.size() - 1) * 99 / 100];
+    result.max_ns = lateness.back();
+    result.mean_ns = sum / lateness.size();
+    return result;
+  }
+
+  /**
+   * writes target and actual time of every access of the last run
+   * @throws std::runtime_error if file can not be written
+   */
+  void save(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+      throw std::runtime_error("could not open deadline file: " +
+                               path.string());
+    }
+
+    file << "target_nanoseconds,actual_nanoseconds\n";
+    for (size_t i = 0; i < targets_.size(); ++i) {
+      file << targets_[i] << "," << actuals_[i] << "\n";
+    }
+  }
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sysfs_scan.hpp>
+#include <timestamp_util.hpp>
+
+static const std::string fname_group_snapshots = "group_snapshots.csv";
+
+/**
+ * @param patterns comma separated glob patterns, e.g. "temp*_input,power*"
+ * @returns the non-empty patterns
+ */
+static std::vector<std::string> parseGlobList(const std::string& patterns) {
+  std::vector<std::string> globs;
+  std::stringstream stream(patterns);
+  for (std::string glob; std::getline(stream, glob, ',');) {
+    if (!glob.empty()) {
+      globs.push_back(glob);
+    }
+  }
+  return globs;
+}
+
+/**
+ * @param patterns comma separated glob patterns, e.g. "temp*_input,power*"
+ * @returns attribute files of chip matching any of the patterns, sorted by
+ * name
+ * @throws std::runtime_error if chip is no directory or nothing matches
+ */
+static std::vector<std::filesystem::path> selectGroupAttributes(
+    const std::filesystem::path& chip,
+    const std::string& patterns) {
+  if (!std::filesystem::is_directory(chip)) {
+    throw std::runtime_error("not a directory: " + chip.string());
+  }
+
+  const auto globs = parseGlobList(patterns);
+
+  std::vector<std::filesystem::path> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(chip)) {
+    std::string feature;
+    std::string fname = entry.path().filename();
+    if (!entry.is_regular_file() || !isHwmonAttribute(fname, feature)) {
+      continue;
+    }
+    for (const auto& glob : globs) {
+      if (0 == fnmatch(glob.c_str(), fname.c_str(), 0)) {
+        paths.push_back(entry.path());
+        break;
+      }
+    }
+  }
+
+  if (paths.empty()) {
+    throw std::runtime_error("no attribute of " + chip.string() +
+                             " matches " + patterns);
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+/**
+ * Reads a group of attribute files, keeping all of them open and reading each
+ * with pread(), so one snapshot costs one syscall per attribute.
+ */
+class GroupReader {
+ private:
+  std::vector<int> fds_;
+  std::vector<std::string> names_;
+
+ public:
+  /**
+   * opens all files
+   * @throws std::runtime_error if a file can not be opened
+   */
+  GroupReader(const std::vector<std::filesystem::path>& paths) {
+    for (const auto& path : paths) {
+      int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) {
+        for (int open_fd : fds_) {
+          close(open_fd);
+        }
+        throw std::runtime_error("[group] could not open " + path.string());
+      }
+      fds_.push_back(fd);
+      names_.push_back(path.filename());
+    }
+  }
+
+  GroupReader(const GroupReader&) = delete;
+  GroupReader& operator=(const GroupReader&) = delete;
+
+  /// @returns number of attributes
+  size_t size() const { return fds_.size(); }
+
+  /// @returns file names of the attributes, e.g. temp1_input
+  const std::vector<std::string>& names() const { return names_; }
+
+  /**
+   * @returns current content of attribute as floating-point number
+   * @throws std::runtime_error if the file is empty
+   */
+  double getvalue(size_t attribute) {
+    char filecontent[1024];
+
+    ssize_t bytesRead =
+        pread(fds_[attribute], filecontent, sizeof(filecontent) - 1, 0);
+    if (bytesRead <= 0) {
+      throw std::runtime_error("[group] could not read " + names_[attribute]);
+    }
+    filecontent[bytesRead] = 0;
+
+    return atof(filecontent);
+  }
+
+  ~GroupReader() {
+    for (int fd : fds_) {
+      close(fd);
+    }
+  }
+};
+
+/**
+ * Snapshots of a group in columnar layout: one timestamp per snapshot and one
+ * column of values per attribute.
+ */
+class GroupStorage {
+ private:
+  std::vector<uint64_t> timestamps_;
+  std::vector<std::vector<double>> columns_;
+
+ public:
+  GroupStorage(size_t attributes, size_t snapshots)
+      : timestamps_(snapshots),
+        columns_(attributes, std::vector<double>(snapshots)) {}
+
+  /// @returns number of snapshots
+  size_t size() const { return timestamps_.size(); }
+
+  /// @returns number of attributes
+  size_t attributes() const { return columns_.size(); }
+
+  std::vector<uint64_t>& timestamps() { return timestamps_; }
+  const std::vector<uint64_t>& timestamps() const { return timestamps_; }
+
+  std::vector<double>& column(size_t attribute) { return columns_[attribute]; }
+  const std::vector<double>& column(size_t attribute) const {
+    return columns_[attribute];
+  }
+
+  /**
+   * writes one row per snapshot: timestamp and the value of every attribute
+   * @param names column headers of the attributes
+   * @throws std::runtime_error if the file can not be written
+   */
+  void save(const std::filesystem::path& path,
+            const std::vector<std::string>& names) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+      throw std::runtime_error("could not open " + path.string());
+    }
+
+    file << "nanoseconds";
+    for (const auto& name : names) {
+      file << "," << name;
+    }
+    file << "\n";
+
+    file << std::fixed;
+    for (size_t i = 0; i < timestamps_.size(); ++i) {
+      file << timestamps_[i];
+      for (const auto& column : columns_) {
+        file << "," << column[i];
+      }
+      file << "\n";
+    }
+  }
+};
+
+/**
+ * takes count snapshots, each with one timestamp taken before reading the
+ * attributes in order
+ * @param first index of the first snapshot in storage
+ */
+static void benchmarkGroup(GroupReader& reader,
+                           size_t count,
+                           GroupStorage& storage,
+                           size_t first = 0) {
+  auto& timestamps = storage.timestamps();
+  for (size_t i = first; i < first + count; ++i) {
+    timestamps[i] = gettimestampnano();
+    for (size_t a = 0; a < reader.size(); ++a) {
+      storage.column(a)[i] = reader.getvalue(a);
+    }
+  }
+}
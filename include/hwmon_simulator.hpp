@@ -0,0 +1,322 @@
+#pragma once
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <argparse/argparse.hpp>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sysfs_scan.hpp>
+
+/**
+ * how simulated values evolve with every update
+ */
+enum class SimulationPattern {
+  /// never changes
+  constant,
+  /// sawtooth of 10 steps, changes on every update
+  step,
+  /// sine wave with a period of 100 updates
+  sine,
+  /// random walk around the base value
+  random,
+};
+
+/**
+ * @throws std::runtime_error for unknown names
+ */
+SimulationPattern parseSimulationPattern(const std::string& name) {
+  if ("constant" == name) {
+    return SimulationPattern::constant;
+  } else if ("step" == name) {
+    return SimulationPattern::step;
+  } else if ("sine" == name) {
+    return SimulationPattern::sine;
+  } else if ("random" == name) {
+    return SimulationPattern::random;
+  }
+  throw std::runtime_error("unknown simulation pattern: " + name +
+                           ", use constant, step, sine or random");
+}
+
+/**
+ * Builds a hwmon-like directory tree (root/hwmon0/temp1_input, ...) and
+ * changes its values from a background thread, so the file-based readers
+ * can be exercised without sensors.
+ *
+ * Put root on a tmpfs (e.g. /dev/shm) to get close to sysfs timings.
+ *
+ * Values are always rewritten in place with the same width, so readers
+ * keeping the file open (like ReaderLseek) see every update, just as with
+ * real sysfs attributes.
+ */
+class HwmonSimulator {
+ private:
+  struct Attribute {
+    std::string name;
+    double base;
+    double amplitude;
+    /// cumulative counter integrating the power attribute of its chip
+    bool is_energy;
+    int fd = -1;
+    double value = 0;
+  };
+
+  static constexpr int value_width = 15;
+
+  std::filesystem::path root_;
+  std::chrono::microseconds interval_;
+  SimulationPattern pattern_;
+  std::vector<std::filesystem::path> chip_dirs_;
+  std::vector<std::vector<Attribute>> chips_;
+  std::mt19937_64 rng_;
+  std::atomic<uint64_t> tick_ = 0;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable stop_cv_;
+  bool stop_requested_ = false;
+
+  static void writeValue(const Attribute& attribute) {
+    char buf[value_width + 2];
+    int len = snprintf(buf, sizeof(buf), "%*lld\n", value_width,
+                       static_cast<long long>(std::llround(attribute.value)));
+    if (pwrite(attribute.fd, buf, len, 0) != len) {
+      throw std::runtime_error("could not write simulated value");
+    }
+  }
+
+  /// advances all attributes by one update
+  void update() {
+    ++tick_;
+    std::uniform_real_distribution<double> step(-0.1, 0.1);
+
+    for (auto& chip : chips_) {
+      double power = 0;
+
+      for (auto& attribute : chip) {
+        if (attribute.is_energy) {
+          // power is in microwatt, energy in microjoule
+          attribute.value +=
+              power * std::chrono::duration<double>(interval_).count();
+        } else {
+          switch (pattern_) {
+            case SimulationPattern::constant:
+              break;
+            case SimulationPattern::step:
+              attribute.value =
+                  attribute.base + (tick_ % 10) * attribute.amplitude / 10;
+              break;
+            case SimulationPattern::sine:
+              attribute.value =
+                  attribute.base +
+                  attribute.amplitude * std::sin(2 * M_PI * tick_ / 100);
+              break;
+            case SimulationPattern::random:
+              attribute.value = std::clamp(
+                  attribute.value + step(rng_) * attribute.amplitude,
+                  attribute.base - attribute.amplitude,
+                  attribute.base + attribute.amplitude);
+              break;
+          }
+        }
+
+        if (attribute.name.starts_with("power")) {
+          power = attribute.value;
+        }
+        writeValue(attribute);
+      }
+    }
+  }
+
+  /// creates chip directories with their attribute files
+  void createChips(int chip_count) {
+    for (int c = 0; c < chip_count; ++c) {
+      auto chip_dir = root_ / ("hwmon" + std::to_string(c));
+      if (!std::filesystem::create_directory(chip_dir)) {
+        throw std::runtime_error("already exists: " + chip_dir.string());
+      }
+      chip_dirs_.push_back(chip_dir);
+
+      std::ofstream(chip_dir / "name") << "hwmondump_sim\n";
+
+      // units as in the hwmon sysfs interface
+      std::vector<Attribute> chip = {
+          {"in0_input", 1200, 50, false},
+          {"fan1_input", 1500, 300, false},
+          {"temp1_input", 40000 + 1000.0 * c, 5000, false},
+          {"temp2_input", 45000 + 1000.0 * c, 5000, false},
+          {"power1_input", 50000000, 20000000, false},
+          {"energy1_input", 0, 0, true},
+      };
+
+      chips_.push_back(chip);
+      for (auto& attribute : chips_.back()) {
+        auto path = chip_dir / attribute.name;
+        attribute.fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (attribute.fd < 0) {
+          throw std::runtime_error("could not create " + path.string());
+        }
+        attribute.value = attribute.base;
+        writeValue(attribute);
+      }
+    }
+  }
+
+  /// closes all files and removes all created chip directories
+  void removeChips() {
+    for (const auto& chip : chips_) {
+      for (const auto& attribute : chip) {
+        close(attribute.fd);
+      }
+    }
+    chips_.clear();
+
+    for (const auto& dir : chip_dirs_) {
+      std::filesystem::remove_all(dir);
+    }
+    chip_dirs_.clear();
+  }
+
+  void updateLoop() {
+    auto next = std::chrono::steady_clock::now() + interval_;
+    std::unique_lock lock(mutex_);
+
+    while (!stop_cv_.wait_until(lock, next, [this] { return stop_requested_; })) {
+      update();
+      next += interval_;
+    }
+  }
+
+ public:
+  /**
+   * creates the tree with initial values, call start() for updates
+   * @param root directory to create the chips hwmon0, hwmon1, ... in
+   * @param chip_count number of simulated chips
+   * @param interval time between two value updates
+   * @throws std::runtime_error if a chip directory already exists
+   */
+  HwmonSimulator(const std::filesystem::path& root,
+                 int chip_count,
+                 std::chrono::microseconds interval,
+                 SimulationPattern pattern)
+      : root_(root), interval_(interval), pattern_(pattern) {
+    if (interval_.count() <= 0) {
+      throw std::runtime_error("update interval must be positive");
+    }
+
+    std::filesystem::create_directories(root_);
+
+    try {
+      createChips(chip_count);
+    } catch (...) {
+      removeChips();
+      throw;
+    }
+  }
+
+  HwmonSimulator(const HwmonSimulator&) = delete;
+  HwmonSimulator& operator=(const HwmonSimulator&) = delete;
+
+  /// starts background updates
+  void start() {
+    stop_requested_ = false;
+    thread_ = std::thread(&HwmonSimulator::updateLoop, this);
+  }
+
+  /// stops background updates, files keep their last value
+  void stop() {
+    if (!thread_.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard lock(mutex_);
+      stop_requested_ = true;
+    }
+    stop_cv_.notify_all();
+    thread_.join();
+  }
+
+  /// number of updates performed so far
+  uint64_t updates() const { return tick_; }
+
+  /// @returns all simulated attributes
+  std::vector<HwmonAttribute> attributes() const { return scanHwmonTree(root_); }
+
+  /// stops updates and removes all created chip directories
+  ~HwmonSimulator() {
+    stop();
+    removeChips();
+  }
+};
+
+/**
+ * runs a HwmonSimulator in the foreground until the given duration passed or
+ * SIGINT/SIGTERM is received
+ * @returns 0 on success
+ * @returns -1 on failure
+ */
+int simulateSubcommand(argparse::ArgumentParser& simulate_command) {
+  std::filesystem::path root = simulate_command.get<std::string>("DIR");
+  int chips = simulate_command.get<int>("--chips");
+  int interval_us = simulate_command.get<int>("--interval-us");
+  int duration = 0;
+  if (simulate_command.is_used("--duration")) {
+    duration = simulate_command.get<int>("--duration");
+  }
+
+  if (chips <= 0) {
+    std::cerr << "simulate at least one chip\n";
+    return -1;
+  }
+
+  // block signals before any thread is started, so sigtimedwait() gets them
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  try {
+    HwmonSimulator simulator(
+        root, chips, std::chrono::microseconds(interval_us),
+        parseSimulationPattern(simulate_command.get<std::string>("--pattern")));
+
+    outputHwmonAttributes(simulator.attributes());
+    std::cout << std::flush;
+
+    simulator.start();
+    std::cerr << "simulating " << chips << " chip(s) in " << root
+              << ", stop with Ctrl-C\n";
+
+    if (duration > 0) {
+      timespec timeout = {.tv_sec = duration, .tv_nsec = 0};
+      sigtimedwait(&signals, nullptr, &timeout);
+    } else {
+      int signal;
+      sigwait(&signals, &signal);
+    }
+
+    simulator.stop();
+    std::cerr << "performed " << simulator.updates() << " updates\n";
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,98 @@
+#ifndef HWMONDUMP_H
+#define HWMONDUMP_H
+
+/*
+ * C API of libhwmondump: the readers of hwmondump record, for use within
+ * other programs.
+ *
+ * All functions returning int return 0 on success and -1 on failure, then
+ * hwmondump_last_error() describes the failure. A reader must not be used by
+ * several threads at once, different readers may.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <hwmondump_plugin.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* incremented on every incompatible change of this header */
+#define HWMONDUMP_API_VERSION 1
+
+#define HWMONDUMP_API __attribute__((visibility("default")))
+
+/* one open sensor */
+typedef struct hwmondump_reader hwmondump_reader;
+
+/* statistics of a series of samples, as reported by hwmondump survey */
+struct hwmondump_stats {
+  uint64_t samples;
+  /* time between consecutive samples, i.e. the cost of one access */
+  uint64_t access_median_ns;
+  uint64_t access_p99_ns;
+  uint64_t access_max_ns;
+  double access_mean_ns;
+  /* number of value changes */
+  uint64_t changes;
+  /* median time between value changes, 0 for less than two changes */
+  uint64_t update_interval_median_ns;
+};
+
+/* returns HWMONDUMP_API_VERSION of the library */
+HWMONDUMP_API unsigned hwmondump_api_version(void);
+
+/* returns description of the last failure of the calling thread */
+HWMONDUMP_API const char* hwmondump_last_error(void);
+
+/* returns nanoseconds since epoch, the clock of all samples */
+HWMONDUMP_API uint64_t hwmondump_timestamp_ns(void);
+
+/*
+ * opens sensor (e.g. /sys/class/hwmon/hwmon0/temp1_input) with method
+ * sysfs, lseek, libsensors, poll or null, or the method of a reader plugin
+ * found in HWMONDUMP_PLUGIN_PATH or the plugin directory
+ * the sensor is read once, so a sensor which can not be read fails here
+ * (poll waits up to its timeout for this read)
+ * returns NULL on failure, see hwmondump_last_error()
+ */
+HWMONDUMP_API hwmondump_reader* hwmondump_reader_open(const char* method,
+                                                      const char* sensor);
+
+/* closes reader, NULL is ignored */
+HWMONDUMP_API void hwmondump_reader_close(hwmondump_reader* reader);
+
+/* returns method name of reader */
+HWMONDUMP_API const char* hwmondump_reader_method(
+    const hwmondump_reader* reader);
+
+/* reads the current value once */
+HWMONDUMP_API int hwmondump_read(hwmondump_reader* reader, double* value);
+
+/* takes count samples as fast as possible */
+HWMONDUMP_API int hwmondump_read_batch(hwmondump_reader* reader,
+                                       struct hwmondump_sample* samples,
+                                       size_t count);
+
+/*
+ * takes count samples at rate_hz, at absolute deadlines like
+ * hwmondump record --rate
+ */
+HWMONDUMP_API int hwmondump_read_batch_rate(hwmondump_reader* reader,
+                                            struct hwmondump_sample* samples,
+                                            size_t count,
+                                            uint32_t rate_hz);
+
+/* computes the statistics of count samples */
+HWMONDUMP_API int hwmondump_compute_stats(
+    const struct hwmondump_sample* samples,
+    size_t count,
+    struct hwmondump_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HWMONDUMP_H */
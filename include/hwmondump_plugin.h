@@ -0,0 +1,79 @@
+#ifndef HWMONDUMP_PLUGIN_H
+#define HWMONDUMP_PLUGIN_H
+
+/*
+ * C ABI of hwmondump reader plugins.
+ *
+ * A plugin is a shared object exporting hwmondump_plugin_entry(), which
+ * returns a pointer to a static struct hwmondump_plugin. hwmondump record
+ * --method NAME loads hwmondump_NAME.so and records the method like a
+ * built-in one: same warmup, same output files, same metadata.
+ *
+ * Every reader opens its own state, so read_batch() may be called from
+ * several threads at once for different states (record --threads).
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* incremented on every incompatible change of this header */
+#define HWMONDUMP_PLUGIN_ABI_VERSION 1
+
+/* one reading, same layout as a sample of hwmondump */
+struct hwmondump_sample {
+  /* nanoseconds since epoch, taken right before the access */
+  uint64_t timestamp_ns;
+  double value;
+};
+
+/* clock of hwmondump, plugins must timestamp their samples with it */
+typedef uint64_t (*hwmondump_timestamp_fn)(void);
+
+struct hwmondump_plugin {
+  /* HWMONDUMP_PLUGIN_ABI_VERSION the plugin was built with */
+  uint32_t abi_version;
+
+  /* method name used for --method and the output files, [a-z0-9-] only */
+  const char* name;
+
+  /*
+   * prepares reading sensor
+   * returns state passed to read_batch() and close(), NULL on failure with
+   * *error set to a static message
+   */
+  void* (*open)(const char* sensor, const char** error);
+
+  /*
+   * takes count samples as fast as possible, each timestamped with
+   * timestamp() right before the access
+   * returns 0 on success, anything else on failure with *error set to a
+   * static message
+   */
+  int (*read_batch)(void* state,
+                    struct hwmondump_sample* samples,
+                    size_t count,
+                    hwmondump_timestamp_fn timestamp,
+                    const char** error);
+
+  /* releases everything open() acquired */
+  void (*close)(void* state);
+};
+
+/* name of the symbol hwmondump looks up */
+#define HWMONDUMP_PLUGIN_ENTRY "hwmondump_plugin_entry"
+
+/* exported even if the plugin is built with hidden visibility */
+#define HWMONDUMP_PLUGIN_EXPORT __attribute__((visibility("default")))
+
+HWMONDUMP_PLUGIN_EXPORT const struct hwmondump_plugin* hwmondump_plugin_entry(
+    void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HWMONDUMP_PLUGIN_H */
@@ -1,10 +1,14 @@
+#pragma once
+
 #include <fcntl.h>
+#include <poll.h>
 #include <sensors/sensors.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include <algorithm>
 #include <argparse/argparse.hpp>
+#include <barrier>
 #include <cassert>
 #include <chrono>
 #include <cmath>
@@ -12,13 +16,37 @@
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
 #include <regex>
+#include <span>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
+#include <adaptive_poll.hpp>
+#include <analysis_util.hpp>
+#include <contention.hpp>
+#include <derived_channel.hpp>
+#include <fixed_rate.hpp>
+#include <group_reader.hpp>
+#include <load_generator.hpp>
 #include <metadata.hpp>
 #include <libsensors_output_list.hpp>
+#include <libsensors_session.hpp>
+#include <online_summary.hpp>
+#include <perf_counters.hpp>
+#include <phase_timer.hpp>
+#include <plugin_reader.hpp>
+#include <reader_options.hpp>
+#include <shm_ring.hpp>
+#include <system_counters.hpp>
+#include <timestamp_util.hpp>
 
 using time_reading_storage = std::vector<std::pair<uint64_t, double>>;
 
@@ -86,19 +114,6 @@ void save(time_reading_storage storage,
                 o_path / (method + fname_suffix_duration_value));
 }
 
-/**
- * @returns timestamp in nanoseconds
- */
-uint64_t gettimestampnano() {
-  // get epoch point
-  auto since_epoch =
-      std::chrono::high_resolution_clock::now().time_since_epoch();
-
-  // return nanoseconds
-  return std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch)
-      .count();
-}
-
 /**
  * requires getvalue() function which returns a floating_point
  */
@@ -108,21 +123,109 @@ concept Reader = requires(T t) {
   { T::methodname() } -> std::convertible_to<std::string>;
 };
 
+/**
+ * Reader which can also take a whole series of samples in one call, keeping
+ * its state (e.g. the file descriptor) in registers between the accesses
+ *
+ * getbatch() must fill every sample with a timestamp taken right before the
+ * access and the value read, just like calling gettimestampnano() and
+ * getvalue() for each sample would.
+ */
+template <typename T>
+concept BatchReader =
+    Reader<T> && requires(T t, std::span<time_reading_storage::value_type> s) {
+      t.getbatch(s);
+    };
+
+/**
+ * Reader which additionally counts events of its own, e.g. how often it was
+ * woken by a notification
+ */
+template <typename T>
+concept ReaderWithStats = Reader<T> && requires(const T t) {
+  { t.stats() } -> std::convertible_to<std::map<std::string, double>>;
+};
+
+/**
+ * @returns cumulative stats() of the reader, empty if it has none
+ */
+template <Reader R>
+std::map<std::string, double> readerStats(const R& reader) {
+  if constexpr (ReaderWithStats<R>) {
+    return reader.stats();
+  } else {
+    return {};
+  }
+}
+
+/**
+ * @returns increase of each stat from before to after
+ */
+static std::map<std::string, double> statsDelta(
+    const std::map<std::string, double>& before,
+    std::map<std::string, double> after) {
+  for (auto& [name, value] : after) {
+    if (before.contains(name)) {
+      value -= before.at(name);
+    }
+  }
+  return after;
+}
+
+/**
+ * fills every sample with gettimestampnano() and getvalue(), or calls
+ * getbatch() once for a BatchReader
+ */
+template <Reader R>
+void takeSamples(R& reader,
+                 std::span<time_reading_storage::value_type> samples) {
+  if constexpr (BatchReader<R>) {
+    reader.getbatch(samples);
+    return;
+  }
+  for (auto& sample : samples) {
+    // put data in vect
+    sample = {gettimestampnano(), reader.getvalue()};
+  }
+}
+
 /**
  * starts 1 benchmark
- * calls gettimestampnano() and getvalue() accessnum times
+ * takes accessnum samples, see takeSamples()
  * @param storage will contain timestamp;value pairs after execution
  */
 template <Reader R>
-void benchmarkNum(const int accessnum,
-                  const std::filesystem::path path,
+void benchmarkNum(R& reader,
+                  const int accessnum,
                   time_reading_storage& storage) {
-  R reader(path);
+  takeSamples(reader, std::span(storage.data(), accessnum));
+}
 
-  for (int i = 0; i < accessnum; ++i) {
-    // put data in vect
+/**
+ * starts 1 benchmark at the fixed rate of schedule
+ * @param storage will contain timestamp;value pairs after execution
+ */
+template <Reader R>
+void benchmarkRate(R& reader,
+                   const int accessnum,
+                   time_reading_storage& storage,
+                   FixedRateSchedule& schedule) {
+  schedule.run(accessnum, [&](int i) {
     storage[i] = {gettimestampnano(), reader.getvalue()};
-  }
+  });
+}
+
+/**
+ * starts 1 benchmark with a freshly constructed reader
+ * @param storage will contain timestamp;value pairs after execution
+ */
+template <Reader R>
+void benchmarkNum(const int accessnum,
+                  const std::filesystem::path path,
+                  time_reading_storage& storage,
+                  const ReaderOptions& reader_options = {}) {
+  R reader = makeReader<R>(path, reader_options);
+  benchmarkNum(reader, accessnum, storage);
 }
 
 /**
@@ -131,8 +234,9 @@ void benchmarkNum(const int accessnum,
  * @returns number of accesses in one second
  */
 template <Reader R>
-uint64_t benchmarkSec(const std::filesystem::path path) {
-  R reader(path);
+uint64_t benchmarkSec(const std::filesystem::path path,
+                      const ReaderOptions& reader_options = {}) {
+  R reader = makeReader<R>(path, reader_options);
   uint64_t count = 0;
 
   // start timer
@@ -147,16 +251,83 @@ uint64_t benchmarkSec(const std::filesystem::path path) {
   return count;
 }
 
+/**
+ * instrumentation of runbench()
+ *
+ * before/after hooks wrap the measured benchmarkNum() call only, neither
+ * warmup nor reader construction are covered; after-hooks are called in
+ * reverse order. The measurement phase encloses the hooks, so its timing is
+ * not counted by them.
+ */
+struct MeasurementHooks {
+  std::vector<std::function<void()>> before;
+  std::vector<std::function<void()>> after;
+
+  /// around work within the measurement which is not measured, like after
+  /// and before, pause-hooks are called in reverse order
+  std::vector<std::function<void()>> pause;
+  std::vector<std::function<void()>> resume;
+
+  /// if set, receives the phases sensor_init, warmup and measurement
+  PhaseTimer* phases = nullptr;
+
+  /// if set, receives the stats() of the reader during the measurement
+  std::map<std::string, double>* reader_stats = nullptr;
+
+  void startPhase(const std::string& name) const {
+    if (phases) {
+      phases->start(name);
+    }
+  }
+
+  /// starts the measurement phase, then calls the before-hooks
+  void beginMeasurement() const {
+    startPhase("measurement");
+    for (const auto& hook : before) {
+      hook();
+    }
+  }
+
+  /// calls the pause-hooks in reverse order
+  void pauseMeasurement() const {
+    for (auto hook = pause.rbegin(); hook != pause.rend(); ++hook) {
+      (*hook)();
+    }
+  }
+
+  /// calls the resume-hooks
+  void resumeMeasurement() const {
+    for (const auto& hook : resume) {
+      hook();
+    }
+  }
+
+  /// calls the after-hooks in reverse order, then stops the phase
+  void endMeasurement() const {
+    for (auto hook = after.rbegin(); hook != after.rend(); ++hook) {
+      (*hook)();
+    }
+    if (phases) {
+      phases->stop();
+    }
+  }
+};
+
 /**
  * starts benchmark with 1/10 accesses of accessnum as warmup
  * then starts real benchmark with accessnum
  *
  * prints runtime estimate and actual runtime in ms
+ * @param schedule if given, warmup and benchmark access at its fixed rate
+ * instead of as fast as possible, it keeps the deadlines of the benchmark
  */
 template <Reader R>
 void runbench(const int& accessnum,
               const std::filesystem::path path,
-              time_reading_storage& storage) {
+              time_reading_storage& storage,
+              const MeasurementHooks& hooks = {},
+              FixedRateSchedule* schedule = nullptr,
+              const ReaderOptions& reader_options = {}) {
   // check if size is big enough
   if (storage.size() < accessnum) {
     throw std::out_of_range("storage too small");
@@ -164,8 +335,16 @@ void runbench(const int& accessnum,
 
   int warmup_num = std::round(double(accessnum) / 10);
 
+  hooks.startPhase("sensor_init");
+  R reader = makeReader<R>(path, reader_options);
+
   // run benchmark warmup
-  benchmarkNum<R>(warmup_num, path, storage);
+  hooks.startPhase("warmup");
+  if (schedule) {
+    benchmarkRate(reader, warmup_num, storage, *schedule);
+  } else {
+    benchmarkNum(reader, warmup_num, storage);
+  }
 
   // dividing by 1000000 to get ms
   double Estimate =
@@ -174,12 +353,299 @@ void runbench(const int& accessnum,
   std::cout << "        Time Estimate:     " << Estimate << " ms\n";
 
   // run real benchmark
-  benchmarkNum<R>(accessnum, path, storage);
+  auto stats_before = readerStats(reader);
+  hooks.beginMeasurement();
+  if (schedule) {
+    benchmarkRate(reader, accessnum, storage, *schedule);
+  } else {
+    benchmarkNum(reader, accessnum, storage);
+  }
+  hooks.endMeasurement();
+  if (hooks.reader_stats) {
+    *hooks.reader_stats = statsDelta(stats_before, readerStats(reader));
+  }
   double Runtime =
     double(storage[accessnum - 1].first - storage[0].first) / 1000000;
   std::cout << "        Real Runtime:      " << Runtime << " ms\n\n";
 }
 
+/**
+ * like runbench(), but accesses are placed by poller: the warmup learns the
+ * update period of the sensor, the benchmark then polls densely around
+ * predicted value changes only
+ *
+ * @param time_limit_ns stop the benchmark after this time (0: accessnum
+ * only), learning stops after a tenth of it
+ * @returns number of accesses stored in storage
+ * @throws std::out_of_range if accessnum is negative or storage is smaller
+ */
+template <Reader R>
+size_t runbenchAdaptive(const int& accessnum,
+                        const uint64_t time_limit_ns,
+                        const std::filesystem::path path,
+                        time_reading_storage& storage,
+                        AdaptivePoller& poller,
+                        const MeasurementHooks& hooks = {},
+                        const ReaderOptions& reader_options = {}) {
+  if (accessnum < 0) {
+    throw std::out_of_range("negative number of accesses");
+  }
+  // check if size is big enough
+  if (storage.size() < static_cast<size_t>(accessnum)) {
+    throw std::out_of_range("storage too small");
+  }
+
+  hooks.startPhase("sensor_init");
+  R reader = makeReader<R>(path, reader_options);
+  auto access = [&](int i) {
+    storage[i] = {gettimestampnano(), reader.getvalue()};
+    return storage[i].second;
+  };
+
+  hooks.startPhase("learn");
+  poller.run(std::max<size_t>(std::round(double(accessnum) / 10), 1),
+             time_limit_ns / 10, access);
+  if (poller.locked()) {
+    std::cout << "        Learned Period:    " << poller.period_ns() / 1e6
+              << " ms\n";
+  } else {
+    std::cout << "        Learned Period:    none yet\n";
+  }
+
+  auto stats_before = readerStats(reader);
+  hooks.beginMeasurement();
+  size_t performed = poller.run(accessnum, time_limit_ns, access);
+  hooks.endMeasurement();
+  if (hooks.reader_stats) {
+    *hooks.reader_stats = statsDelta(stats_before, readerStats(reader));
+  }
+
+  if (performed > 0) {
+    double Runtime =
+        double(storage[performed - 1].first - storage[0].first) / 1000000;
+    std::cout << "        Real Runtime:      " << Runtime << " ms\n\n";
+  }
+  return performed;
+}
+
+/**
+ * like runbench(), but without per-sample storage: samples are taken into a
+ * small fixed buffer chunk by chunk and folded into summary right away, so
+ * memory does not grow with the number of accesses
+ *
+ * Folding is not measured: the pause- and resume-hooks are called around it
+ * and the time from the last sample of a chunk to the first of the next one
+ * is not counted as access time.
+ *
+ * The warmup takes 1/10 of the accesses (or of the time) and sizes the
+ * chunks to about 10 ms, so the time limit is checked often enough.
+ *
+ * @param accessnum accesses of the benchmark, 0 to be limited by time only
+ * @param time_limit_ns stop the benchmark after this time, 0 for accessnum
+ * only
+ * @returns number of accesses of the benchmark
+ */
+template <Reader R>
+uint64_t runbenchSummary(const uint64_t accessnum,
+                         const uint64_t time_limit_ns,
+                         const std::filesystem::path path,
+                         OnlineSampleSummary& summary,
+                         const MeasurementHooks& hooks = {},
+                         const ReaderOptions& reader_options = {}) {
+  constexpr size_t max_chunk = 4096;
+  constexpr uint64_t chunk_time_ns = 10000000;
+  time_reading_storage chunk(max_chunk);
+  size_t chunk_size = 64;
+
+  hooks.startPhase("sensor_init");
+  R reader = makeReader<R>(path, reader_options);
+
+  // takes samples until limit or time_ns is reached, passes every chunk
+  auto sample = [&](uint64_t limit, uint64_t time_ns, auto&& consume) {
+    uint64_t performed = 0;
+    const uint64_t start = gettimestampnano();
+    while (0 == limit || performed < limit) {
+      const size_t size =
+          0 == limit ? chunk_size : std::min<uint64_t>(chunk_size,
+                                                       limit - performed);
+      const auto samples = std::span(chunk.data(), size);
+      takeSamples(reader, samples);
+      consume(samples);
+      performed += size;
+      if (time_ns > 0 && samples.back().first - start >= time_ns) {
+        break;
+      }
+    }
+    return performed;
+  };
+
+  // run benchmark warmup
+  hooks.startPhase("warmup");
+  const uint64_t warmup_start = gettimestampnano();
+  uint64_t warmup_end = warmup_start;
+  const uint64_t warmup_num =
+      sample(accessnum > 0 ? std::max<uint64_t>(accessnum / 10, 1) : 0,
+             time_limit_ns / 10,
+             [&](auto samples) { warmup_end = samples.back().first; });
+
+  const double access_ns =
+      std::max(double(warmup_end - warmup_start) / warmup_num, 1.0);
+  chunk_size = std::clamp<size_t>(chunk_time_ns / access_ns, 1, max_chunk);
+  if (accessnum > 0) {
+    std::cout << "        Time Estimate:     " << access_ns * accessnum / 1e6
+              << " ms\n";
+  }
+
+  // run real benchmark
+  auto stats_before = readerStats(reader);
+  hooks.beginMeasurement();
+  const uint64_t performed =
+      sample(accessnum, time_limit_ns, [&](auto samples) {
+        hooks.pauseMeasurement();
+        for (const auto& [timestamp, value] : samples) {
+          summary.push(timestamp, value);
+        }
+        summary.gap();
+        hooks.resumeMeasurement();
+      });
+  hooks.endMeasurement();
+  if (hooks.reader_stats) {
+    *hooks.reader_stats = statsDelta(stats_before, readerStats(reader));
+  }
+  std::cout << "        Real Runtime:      " << summary.runtime_ns() / 1e6
+            << " ms\n\n";
+  return performed;
+}
+
+/**
+ * work of one thread of a concurrent run
+ */
+struct ConcurrentJob {
+  /// constructs the reader and runs the warmup
+  std::function<void()> prepare;
+  /// runs the measurement, started together with all other jobs
+  std::function<void()> measure;
+};
+
+/**
+ * @returns job which reads path with its own R into storage, with a warmup of
+ * 1/10 accessnum
+ * @throws std::out_of_range if accessnum is negative or storage is smaller
+ */
+template <Reader R>
+ConcurrentJob concurrentJob(const int accessnum,
+                            const std::filesystem::path path,
+                            time_reading_storage& storage,
+                            const ReaderOptions& reader_options = {}) {
+  if (accessnum < 0) {
+    throw std::out_of_range("negative number of accesses");
+  }
+  if (storage.size() < static_cast<size_t>(accessnum)) {
+    throw std::out_of_range("storage too small");
+  }
+
+  // readers need not be movable, so they are kept behind a pointer
+  auto reader = std::make_shared<std::unique_ptr<R>>();
+  const int warmup_num = std::round(double(accessnum) / 10);
+  return {
+      .prepare =
+          [=, &storage] {
+            reader->reset(new R(makeReader<R>(path, reader_options)));
+            benchmarkNum(**reader, warmup_num, storage);
+          },
+      .measure = [=, &storage] { benchmarkNum(**reader, accessnum, storage); },
+  };
+}
+
+/**
+ * runs every job in its own thread
+ *
+ * job i is pinned to the i-th allowed cpu (starting over if there are more
+ * jobs than cpus) and prepared; the measurements start together once all
+ * jobs are prepared
+ *
+ * @returns cpu of every job
+ * @throws the first exception of any job, after all threads finished
+ */
+static std::vector<int> runConcurrently(const std::vector<ConcurrentJob>& jobs,
+                                        PhaseTimer* phases = nullptr) {
+  const auto allowed = allowedCpus();
+  std::vector<int> cpus;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    cpus.push_back(allowed[i % allowed.size()]);
+  }
+
+  std::vector<std::exception_ptr> errors(jobs.size());
+  // the main thread joins to time the measurement
+  std::barrier start(jobs.size() + 1);
+
+  if (phases) {
+    phases->start("warmup");
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    threads.emplace_back([&, i] {
+      try {
+        pinCurrentThread(cpus[i]);
+        jobs[i].prepare();
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+
+      // a failed thread still has to arrive, or the others would wait forever
+      start.arrive_and_wait();
+      if (errors[i]) {
+        return;
+      }
+
+      try {
+        jobs[i].measure();
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+
+  start.arrive_and_wait();
+  if (phases) {
+    phases->start("measurement");
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (phases) {
+    phases->stop();
+  }
+
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  return cpus;
+}
+
+/**
+ * like runbench(), but one thread per storage reads the same sensor with its
+ * own reader, all at the same time (see runConcurrently())
+ *
+ * @param storages one storage per thread, each at least accessnum large
+ * @throws the first exception of any thread, after all threads finished
+ */
+template <Reader R>
+void runbenchThreads(const int& accessnum,
+                     const std::filesystem::path path,
+                     std::vector<time_reading_storage>& storages,
+                     PhaseTimer* phases = nullptr,
+                     const ReaderOptions& reader_options = {}) {
+  std::vector<ConcurrentJob> jobs;
+  for (auto& storage : storages) {
+    jobs.push_back(
+        concurrentJob<R>(accessnum, path, storage, reader_options));
+  }
+  runConcurrently(jobs, phases);
+}
+
 /**
  * creates value_duration vector
  * @returns vector of type time_reading_storage with the duration each value was
@@ -237,11 +703,28 @@ class ReaderSysfs {
    * @throws std::runtime_error if open() didn't work
    * @throws std::runtime error if file is empty
    */
-  double getvalue() {
+  double getvalue() { return readOnce(path_.c_str()); }
+
+  /**
+   * takes one sample per element of samples, see BatchReader
+   * @throws std::runtime_error like getvalue()
+   */
+  void getbatch(std::span<time_reading_storage::value_type> samples) {
+    const char* path = path_.c_str();
+    for (auto& sample : samples) {
+      sample.first = gettimestampnano();
+      sample.second = readOnce(path);
+    }
+  }
+
+  ~ReaderSysfs() {}
+
+ private:
+  static double readOnce(const char* path) {
     char filecontent[1024];
 
     // opens file with path from command line arg
-    int fd = open(path_.c_str(), O_RDONLY);
+    int fd = open(path, O_RDONLY);
     if (fd < 0) {
       throw std::runtime_error(
           "[sysfs] error with sensorfile handling, does your file exist?");
@@ -263,8 +746,6 @@ class ReaderSysfs {
 
     return atof(filecontent);
   }
-
-  ~ReaderSysfs() {}
 };
 
 /**
@@ -295,15 +776,40 @@ class ReaderLseek {
    * @throws std::runtime error if file is empty
    */
   double getvalue() {
-    char filecontent[1024];
+    checkOpen();
+    return readOnce(fd_);
+  }
+
+  /**
+   * takes one sample per element of samples, checking the file only once,
+   * see BatchReader
+   * @throws std::runtime_error like getvalue()
+   */
+  void getbatch(std::span<time_reading_storage::value_type> samples) {
+    checkOpen();
+    const int fd = fd_;
+    for (auto& sample : samples) {
+      sample.first = gettimestampnano();
+      sample.second = readOnce(fd);
+    }
+  }
+
+  // close file at end of programm
+  ~ReaderLseek() { close(fd_); }
 
-    // checks if file is open
+ private:
+  // checks if file is open
+  void checkOpen() const {
     if (fd_ < 0) {
       throw std::runtime_error(
           "[lseek] error with sensorfile handling, does your file exist?");
     }
+  }
 
-    size_t bytesRead = read(fd_, filecontent, sizeof(filecontent) - 1);
+  static double readOnce(int fd) {
+    char filecontent[1024];
+
+    size_t bytesRead = read(fd, filecontent, sizeof(filecontent) - 1);
 
     if (bytesRead == 0) {
       throw std::runtime_error("could not read sensor: file empty");
@@ -315,42 +821,31 @@ class ReaderLseek {
     }
 
     // reset position to beginning of file
-    lseek(fd_, 0, SEEK_SET);
+    lseek(fd, 0, SEEK_SET);
 
     return atof(filecontent);
   }
-
-  // close file at end of programm
-  ~ReaderLseek() { close(fd_); }
 };
 
 /**
  * Reader class with method:
  * call on libsensors plugin
  *
- * calls sensors_init() in constructor, sensors_cleanup() in destructor
+ * shares the libsensors session with all other readers of the process, so
+ * readers can coexist (also in multiple threads)
  */
 class ReaderLibsens {
  private:
   std::string path_;
-  std::pair<const sensors_chip_name*, int> item_;
+  std::shared_ptr<LibsensorsSession> session_;
+  LibsensorsSession::Item item_;
 
  public:
-  // when reader is created it fills items_ list with sensor at path_
-  ReaderLibsens(std::string path) : path_(path) {
-    sensors_init(nullptr);
-    SensorList sensor_list;
-
-    for (const auto& sensor : sensor_list.sensors) {
-      std::string sensor_path = sensor.chip_path + "/" + sensor.subfeature_name;
-      if (sensor_path == path) {
-        item_ = std::make_pair(sensor.chip_name, sensor.subfeature_num);
-        return;
-      }
-    }
-
-    throw std::runtime_error("could not find sensors (total " + std::to_string(sensor_list.sensors.size()) + " sensors availabel)");
-  }
+  // when reader is created it looks up the sensor at path_ in the session
+  ReaderLibsens(std::string path)
+      : path_(path),
+        session_(LibsensorsSession::acquire()),
+        item_(session_->find(path_)) {}
 
   /**
    * returns string of method name
@@ -366,8 +861,7 @@ class ReaderLibsens {
   double getvalue() {
     double value = 0;
 
-    // first is chip name, second is subfeature number
-    int is_error = sensors_get_value(item_.first, item_.second, &value);
+    int is_error = sensors_get_value(item_.chip, item_.subfeature, &value);
 
     if (is_error != 0) {
       throw std::runtime_error("Error with libsensors call");
@@ -378,8 +872,6 @@ class ReaderLibsens {
 
     return parsed_content;
   }
-
-  ~ReaderLibsens() { sensors_cleanup(); };
 };
 
 /**
@@ -399,42 +891,852 @@ class ReaderNull {
    * @returns 0
    */
   double getvalue() { return 0; }
+
+  /**
+   * fills samples with timestamps and 0, see BatchReader
+   */
+  void getbatch(std::span<time_reading_storage::value_type> samples) {
+    for (auto& sample : samples) {
+      sample = {gettimestampnano(), 0};
+    }
+  }
 };
 
+/**
+ * Reader class that replays a recording:
+ * values of a METHOD_timestamp_value.csv are returned in order, starting
+ * over at the end of the file
+ *
+ * the whole file is loaded in the constructor, so getvalue() does not touch
+ * the disk and the pipeline behind it (getvalueduration, output, analysis)
+ * can be stressed with realistic data at full speed
+ */
+class ReaderReplay {
+ private:
+  std::vector<std::pair<uint64_t, double>> samples_;
+  /// follow the recorded timing, see getvalue()
+  bool replay_timing_;
+  /// sample returned with replay_timing_
+  size_t current_ = 0;
+  size_t next_ = 0;
+  /// time of the first getvalue() call, 0 before
+  uint64_t start_ = 0;
+  /// offset added to recorded times after starting over
+  uint64_t loop_offset_ = 0;
+
+  void advance() {
+    if (++next_ == samples_.size()) {
+      // start over one average access interval after the last sample
+      uint64_t span = samples_.back().first - samples_.front().first;
+      uint64_t interval = span / std::max<size_t>(samples_.size() - 1, 1);
+      loop_offset_ += span + std::max<uint64_t>(interval, 1);
+      next_ = 0;
+    }
+  }
+
+ public:
+  /**
+   * loads all samples of the recording, with options.replay_timing
+   * getvalue() follows the recorded timing
+   * @throws std::runtime_error if the file can not be read or is empty
+   */
+  ReaderReplay(const std::filesystem::path& path,
+               const ReaderOptions& options = {})
+      : replay_timing_(options.replay_timing) {
+    forEachCsvSample(path, [&](uint64_t, const auto& sample) {
+      samples_.push_back(sample);
+    });
+
+    if (samples_.empty()) {
+      throw std::runtime_error("[replay] recording is empty: " +
+                               path.string());
+    }
+  }
+
+  /**
+   * returns string of method name
+   */
+  static const char* methodname() { return "replay"; };
+
+  /**
+   * @returns next recorded value, or with replay_timing the sample whose
+   * recorded time (relative to the first sample) passed last since the first
+   * call, like a sensor updating at the recorded times
+   */
+  double getvalue() {
+    if (!replay_timing_) {
+      double value = samples_[next_].second;
+      advance();
+      return value;
+    }
+
+    uint64_t now = gettimestampnano();
+    if (0 == start_) {
+      start_ = now;
+    }
+
+    while (start_ + loop_offset_ +
+               (samples_[next_].first - samples_.front().first) <=
+           now) {
+      current_ = next_;
+      advance();
+    }
+
+    return samples_[current_].second;
+  }
+};
+
+/**
+ * Reader class with method:
+ * open - pread - poll - pread - poll - ... - close
+ *
+ * waits for a change notification (POLLPRI, sent by drivers calling
+ * sysfs_notify(), e.g. for alarms) before every read, and reads anyway after
+ * ReaderOptions::poll_timeout_ms for attributes which never notify
+ */
+class ReaderPoll {
+ private:
+  const std::string path_;
+  int fd_;
+  const int timeout_ms_;
+  /// errno of the initial read, 0 if it succeeded
+  int initial_error_ = 0;
+  uint64_t notifications_ = 0;
+  uint64_t timeouts_ = 0;
+
+  double readvalue() {
+    char filecontent[1024];
+
+    ssize_t bytesRead = pread(fd_, filecontent, sizeof(filecontent) - 1, 0);
+    if (bytesRead <= 0) {
+      throw std::runtime_error("[poll] could not read sensor: file empty");
+    }
+    filecontent[bytesRead] = 0;
+
+    return atof(filecontent);
+  }
+
+ public:
+  /**
+   * opens the file and reads it once, which is required before sysfs
+   * attributes report further changes
+   */
+  ReaderPoll(const std::filesystem::path& path,
+             const ReaderOptions& options = {})
+      : path_(path),
+        fd_(open(path_.c_str(), O_RDONLY)),
+        timeout_ms_(options.poll_timeout_ms) {
+    char discard[1024];
+    if (fd_ >= 0 && pread(fd_, discard, sizeof(discard), 0) < 0) {
+      initial_error_ = errno;
+    }
+  }
+
+  ReaderPoll(const ReaderPoll&) = delete;
+  ReaderPoll& operator=(const ReaderPoll&) = delete;
+
+  /**
+   * returns string of method name
+   */
+  static const char* methodname() { return "poll"; };
+
+  /**
+   * waits for a notification or the poll timeout, then reads the file
+   *
+   * @returns current content of said file as floating-point number
+   * @throws std::runtime_error if open(), the initial read or poll() didn't
+   * work
+   * @throws std::runtime error if file is empty
+   */
+  double getvalue() {
+    if (fd_ < 0) {
+      throw std::runtime_error(
+          "[poll] error with sensorfile handling, does your file exist?");
+    }
+    if (0 != initial_error_) {
+      throw std::runtime_error("[poll] could not read sensor: " +
+                               std::string(strerror(initial_error_)));
+    }
+
+    pollfd pfd = {.fd = fd_, .events = POLLPRI, .revents = 0};
+    int ready = poll(&pfd, 1, timeout_ms_);
+    if (ready < 0 && errno != EINTR) {
+      throw std::runtime_error("[poll] poll() failed: " +
+                               std::string(strerror(errno)));
+    }
+
+    if (ready > 0 && (pfd.revents & (POLLPRI | POLLERR))) {
+      ++notifications_;
+    } else {
+      ++timeouts_;
+    }
+
+    return readvalue();
+  }
+
+  /**
+   * @returns number of wakeups by notification and by timeout
+   */
+  std::map<std::string, double> stats() const {
+    return {
+        {"notifications", double(notifications_)},
+        {"timeouts", double(timeouts_)},
+    };
+  }
+
+  ~ReaderPoll() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+};
+
+/**
+ * settings of one hwmondump record call, shared by all methods
+ */
+struct RecordOptions {
+  /// number of accesses, 0 if determined by accesstime
+  int accessnum = 0;
+  /// seconds to record, 0 if accessnum is given
+  int accesstime = 0;
+  std::filesystem::path sensor_path;
+  std::filesystem::path output_path;
+
+  /// snapshot interrupt and context switch counters around the measurement
+  bool system_counters = false;
+  /// additionally sample those counters every n ms, 0 = before/after only
+  int system_counters_interval_ms = 0;
+
+  /// count cpu events with perf_event_open() during the measurement
+  bool perf_counters = true;
+
+  /// print resource usage of every phase as table
+  bool phase_table = false;
+
+  /// accesses per second, 0 = as fast as possible
+  int rate_hz = 0;
+  /// with rate_hz: busy-wait this long before each deadline
+  int rate_spin_us = 0;
+
+  /// poll densely only around predicted value changes
+  bool adaptive = false;
+
+  /// read concurrently with this many threads, 0 = single reader
+  int threads = 0;
+
+  /// run all selected methods at the same time instead of one after another
+  bool concurrent = false;
+
+  /// save power (energy sensors) or rate of change next to the raw data
+  bool derive = false;
+  /// with derive: value at which the counter wraps, 0 if unknown
+  double derive_wrap = 0;
+
+  /// settings of the readers of this run
+  ReaderOptions reader;
+
+  /// keep histograms instead of the samples, save only those and metadata
+  bool summary_only = false;
+};
+
+/**
+ * with options.derive: derives the channel of the sensor from storage and
+ * saves it as <method>_derived.csv
+ */
+static void saveDerivedChannel(const time_reading_storage& storage,
+                               const std::string& method,
+                               const RecordOptions& options,
+                               Metadata& metadata) {
+  if (!options.derive) {
+    return;
+  }
+
+  DerivedChannel channel(DerivedChannel::kindFor(options.sensor_path),
+                         options.derive_wrap);
+  for (const auto& [timestamp, value] : storage) {
+    channel.push(timestamp, value);
+  }
+
+  double mean = 0;
+  for (const auto& sample : channel.samples()) {
+    mean += sample.second / channel.samples().size();
+  }
+  std::cout << "        Derived " << std::left << std::setw(11)
+            << channel.columnName() + ":" << std::right
+            << channel.samples().size() << " samples, mean " << mean << ", "
+            << channel.wraps() << " wraps, " << channel.resets()
+            << " resets\n\n";
+
+  metadata.derived[method] = {
+      {"samples", double(channel.samples().size())},
+      {"mean", mean},
+      {"wraps", double(channel.wraps())},
+      {"resets", double(channel.resets())},
+  };
+  channel.save(options.output_path / (method + fname_suffix_derived));
+}
+
+/**
+ * @returns cpu time per wall time of the measurement phase, 0 if not timed
+ */
+static double measurementCpuUtilization(const PhaseTimer& phases) {
+  for (const auto& phase : phases.phases()) {
+    if ("measurement" == phase.name && phase.wall_s > 0) {
+      return phase.cpu_s / phase.wall_s;
+    }
+  }
+  return 0;
+}
+
+/**
+ * prints the reader stats and the perf counters per access of a measurement
+ * of method and stores them in metadata
+ */
+static void reportCounters(const std::string& method,
+                           const std::map<std::string, double>& reader_stats,
+                           const std::optional<PerfCounters>& perf,
+                           uint64_t accesses,
+                           Metadata& metadata) {
+  if (!reader_stats.empty()) {
+    std::cout << "        Reader Stats:\n";
+    for (const auto& [name, value] : reader_stats) {
+      std::cout << "            " << std::left << std::setw(19) << name
+                << std::right << value << "\n";
+    }
+    std::cout << "\n";
+    metadata.reader_stats[method] = reader_stats;
+  }
+
+  if (perf && !perf->available()) {
+    std::cout << "        Perf Counters:     not available\n\n";
+  } else if (perf && accesses > 0) {
+    std::map<std::string, double> per_access;
+    for (const auto& [name, value] : perf->read()) {
+      per_access[name] = value / accesses;
+    }
+
+    std::cout << "        Perf Counters (per access"
+              << (perf->kernelIncluded() ? "" : ", user space only") << "):\n";
+    for (const auto& [name, value] : per_access) {
+      std::cout << "            " << std::left << std::setw(19) << name
+                << std::right << value << "\n";
+    }
+    std::cout << "\n";
+
+    metadata.perf_per_access[method] = per_access;
+    metadata.perf_kernel_included = perf->kernelIncluded();
+  }
+}
+
+/**
+ * Runs the runbenchThreads() function with user-facing output, thread i saves
+ * its readings as method "<methodname>-t<i>"
+ */
+template <Reader R>
+static void runbenchThreadsWrapper(const RecordOptions& options,
+                                   Metadata& metadata) {
+  const std::string method = readerMethod<R>(options.reader);
+  int accessnum = options.accessnum;
+  const auto& path = options.sensor_path;
+  const auto& output_path = options.output_path;
+
+  std::vector<std::string> thread_methods;
+  for (int i = 0; i < options.threads; ++i) {
+    thread_methods.push_back(method + std::string("-t") +
+                             std::to_string(i));
+    checkalloutputfiles(thread_methods.back(), output_path);
+    if (options.derive) {
+      checkoutputfile(output_path / (thread_methods.back() + fname_suffix_derived));
+    }
+  }
+
+  // the readers run in threads of their own, so their cpu time is that of
+  // the whole process, --load included
+  PhaseTimer phases;
+
+  // determine update time, without contention
+  if (options.accesstime > 0) {
+    phases.start("estimate");
+    std::cout << "[" << method << "] estimating number of accesses for " << options.accesstime << " s runtime...\n";
+    auto accesses_per_second = benchmarkSec<R>(path, options.reader);
+    accessnum = accesses_per_second * options.accesstime;
+    std::cout << "[" << method << "] will perform " << accessnum << " accesses per thread\n";
+  }
+
+  // create data storage
+  phases.start("allocate");
+  std::vector<time_reading_storage> storages(options.threads,
+                                             time_reading_storage(accessnum));
+
+  std::cout << "[" << method << "] starting benchmark with " << options.threads << " threads...\n";
+  runbenchThreads<R>(accessnum, path, storages, &phases, options.reader);
+
+  uint64_t first = UINT64_MAX;
+  uint64_t last = 0;
+  for (const auto& storage : storages) {
+    if (!storage.empty()) {
+      first = std::min(first, storage.front().first);
+      last = std::max(last, storage.back().first);
+    }
+  }
+  double runtime_s = last > first ? double(last - first) / 1e9 : 0;
+  double throughput =
+      runtime_s > 0 ? double(accessnum) * options.threads / runtime_s : 0;
+
+  std::cout << "        Real Runtime:      " << runtime_s * 1000 << " ms\n"
+            << "        Throughput:        " << throughput
+            << " accesses/s (" << throughput / options.threads
+            << " per thread)\n";
+  metadata.contention[method] = {
+      {"threads", double(options.threads)},
+      {"runtime_ns", double(last > first ? last - first : 0)},
+      {"throughput_per_s", throughput},
+  };
+
+  for (int i = 0; i < options.threads; ++i) {
+    auto latency = accessLatencies(storages[i]);
+    std::cout << "        " << std::left << std::setw(19)
+              << "Latency t" + std::to_string(i) + ":" << std::right
+              << "median " << latency.median_ns << " ns, p99 "
+              << latency.p99_ns << " ns, max " << latency.max_ns << " ns\n";
+    metadata.contention[thread_methods[i]] = {
+        {"latency_mean_ns", latency.mean_ns},
+        {"latency_median_ns", double(latency.median_ns)},
+        {"latency_p99_ns", double(latency.p99_ns)},
+        {"latency_max_ns", double(latency.max_ns)},
+    };
+  }
+  std::cout << "\n";
+
+  std::cout << "[" << method << "] postprocessing and saving...\n";
+  phases.start("save");
+  for (int i = 0; i < options.threads; ++i) {
+    save(storages[i], getvalueduration(storages[i]), thread_methods[i],
+         output_path);
+    saveDerivedChannel(storages[i], thread_methods[i], options, metadata);
+  }
+  phases.stop();
+
+  metadata.phases[method] = phases.phases();
+  if (options.phase_table) {
+    std::cout << "[" << method << "] phases:\n";
+    phases.print(std::cout, "        ");
+  }
+
+  std::cout << "[" << method << "] done\n\n";
+}
+
+/**
+ * Runs the runbenchSummary() function with user-facing output, saves the
+ * histograms as <method>_histogram.csv and the summary to metadata instead of
+ * the samples
+ */
+template <Reader R>
+static void runbenchSummaryWrapper(const RecordOptions& options,
+                                   Metadata& metadata) {
+  const std::string method = readerMethod<R>(options.reader);
+  const auto histogram_path =
+      options.output_path / (method + fname_suffix_histogram);
+  checkoutputfile(histogram_path);
+
+  // this thread samples, --load and the counter sampler run in others
+  PhaseTimer phases(PhaseClock::thread);
+  std::map<std::string, double> reader_stats;
+  MeasurementHooks hooks;
+  hooks.phases = &phases;
+  hooks.reader_stats = &reader_stats;
+
+  std::optional<PerfCounters> perf;
+  if (options.perf_counters) {
+    perf.emplace();
+    hooks.before.push_back([&] { perf->enable(); });
+    hooks.after.push_back([&] { perf->disable(); });
+    // folding the samples is not counted
+    hooks.pause.push_back([&] { perf->disable(); });
+    hooks.resume.push_back([&] { perf->resume(); });
+  }
+
+  if (options.accessnum > 0) {
+    std::cout << "[" << method << "] will perform " << options.accessnum << " accesses, keeping histograms only\n";
+  } else {
+    std::cout << "[" << method << "] will record for " << options.accesstime << " s, keeping histograms only\n";
+  }
+
+  std::cout << "[" << method << "] starting benchmark...\n";
+  OnlineSampleSummary summary;
+  const uint64_t performed = runbenchSummary<R>(
+      options.accessnum, uint64_t(options.accesstime) * 1000000000,
+      options.sensor_path, summary, hooks, options.reader);
+
+  const auto& access = summary.access();
+  const auto durations = summary.valueDuration();
+  std::cout << "        Accesses:          " << performed << "\n"
+            << "        Access Time:       median " << access.quantile(0.5)
+            << " ns, p99 " << access.quantile(0.99) << " ns, max "
+            << access.max() << " ns\n"
+            << "        Changes:           " << summary.changes()
+            << ", lasting median " << durations.quantile(0.5) << " ns\n\n";
+
+  reportCounters(method, reader_stats, perf, performed, metadata);
+
+  std::cout << "[" << method << "] saving...\n";
+  phases.start("save");
+  metadata.summary[method] = summary.toMap();
+  summary.save(histogram_path);
+  phases.stop();
+
+  metadata.phases[method] = phases.phases();
+  if (options.phase_table) {
+    std::cout << "[" << method << "] phases:\n";
+    phases.print(std::cout, "        ");
+  }
+
+  std::cout << "[" << method << "] done\n\n";
+}
+
 /**
  * Runs the runbench() function with user-facing output
  * if accessnum is >0, perform time-based (auto-) determination of accessnum
  */
 template <Reader R>
-static void runbenchWrapper(int accessnum,
-                            const int accesstime,
-                            const std::filesystem::path& path,
-                            const std::filesystem::path& output_path) {
+static void runbenchWrapper(const RecordOptions& options, Metadata& metadata) {
+  if (options.threads > 0) {
+    runbenchThreadsWrapper<R>(options, metadata);
+    return;
+  }
+  if (options.summary_only) {
+    runbenchSummaryWrapper<R>(options, metadata);
+    return;
+  }
+
+  const std::string method = readerMethod<R>(options.reader);
+
+  int accessnum = options.accessnum;
+  const auto& path = options.sensor_path;
+  const auto& output_path = options.output_path;
+
   // check if outputfile(s) already exists
-  checkalloutputfiles(R::methodname(), output_path);
+  checkalloutputfiles(method, output_path);
+  if (options.derive) {
+    checkoutputfile(output_path / (method + fname_suffix_derived));
+  }
+  const auto counters_path =
+      output_path / (method + fname_suffix_system_counters);
+  if (options.system_counters) {
+    checkoutputfile(counters_path);
+  }
+  const auto deadlines_path =
+      output_path / (method + fname_suffix_deadlines);
+  std::optional<FixedRateSchedule> schedule;
+  if (options.rate_hz > 0) {
+    checkoutputfile(deadlines_path);
+    schedule.emplace(options.rate_hz, uint64_t(options.rate_spin_us) * 1000);
+  }
 
-  // determine update time
-  if (accesstime > 0) {
-    std::cout << "[" << R::methodname() << "] estimating number of accesses for " << accesstime << " s runtime...\n";
-    auto accesses_per_second = benchmarkSec<R>(path);
-    accessnum = accesses_per_second * accesstime;
+  // this thread samples, --load and the counter sampler run in others
+  PhaseTimer phases(PhaseClock::thread);
+  std::map<std::string, double> reader_stats;
+  MeasurementHooks hooks;
+  hooks.phases = &phases;
+  hooks.reader_stats = &reader_stats;
 
-    std::cout << "[" << R::methodname() << "] will perform " << accessnum << " accesses\n";
+  // determine update time
+  if (options.accesstime > 0 && schedule) {
+    accessnum = options.rate_hz * options.accesstime;
+    std::cout << "[" << method << "] will perform " << accessnum << " accesses at " << options.rate_hz << " Hz\n";
+  } else if (options.accesstime > 0) {
+    phases.start("estimate");
+    std::cout << "[" << method << "] estimating number of accesses for " << options.accesstime << " s runtime...\n";
+    auto accesses_per_second = benchmarkSec<R>(path, options.reader);
+    accessnum = accesses_per_second * options.accesstime;
+
+    if (options.adaptive) {
+      std::cout << "[" << method << "] will perform at most " << accessnum << " accesses in " << options.accesstime << " s\n";
+    } else {
+      std::cout << "[" << method << "] will perform " << accessnum << " accesses\n";
+    }
   }
 
   // create data storage
+  phases.start("allocate");
   time_reading_storage storage(accessnum);
 
-  std::cout << "[" << R::methodname() << "] starting benchmark...\n";
-  runbench<R>(accessnum, path, storage);
+  SystemCounterSampler counters(options.system_counters_interval_ms);
+  if (options.system_counters) {
+    hooks.before.push_back([&] { counters.start(); });
+    hooks.after.push_back([&] { counters.stop(); });
+  }
+
+  std::optional<PerfCounters> perf;
+  if (options.perf_counters) {
+    perf.emplace();
+    // innermost hook, so the other instrumentation is not counted
+    hooks.before.push_back([&] { perf->enable(); });
+    hooks.after.push_back([&] { perf->disable(); });
+  }
+
+  std::cout << "[" << method << "] starting benchmark...\n";
+  if (options.adaptive) {
+    AdaptivePoller poller;
+    storage.resize(runbenchAdaptive<R>(
+        accessnum, uint64_t(options.accesstime) * 1000000000, path, storage,
+        poller, hooks, options.reader));
+
+    const auto& adaptive = poller.summary();
+    double cpu_utilization = measurementCpuUtilization(phases);
+    std::cout << "        Period:            " << adaptive.period_ns / 1e6
+              << " ms\n"
+              << "        Changes:           " << adaptive.changes << " in "
+              << adaptive.polls << " accesses\n"
+              << "        Change Precision:  median "
+              << adaptive.median_uncertainty_ns << " ns, max "
+              << adaptive.max_uncertainty_ns << " ns\n"
+              << "        Late Wakeups:      " << adaptive.late_wakeups << "\n"
+              << "        Relocks:           " << adaptive.relocks << "\n"
+              << "        CPU Utilization:   " << cpu_utilization * 100
+              << " %\n\n";
+
+    metadata.adaptive[method] = {
+        {"changes", double(adaptive.changes)},
+        {"polls", double(adaptive.polls)},
+        {"period_ns", double(adaptive.period_ns)},
+        {"median_uncertainty_ns", double(adaptive.median_uncertainty_ns)},
+        {"max_uncertainty_ns", double(adaptive.max_uncertainty_ns)},
+        {"late_wakeups", double(adaptive.late_wakeups)},
+        {"relocks", double(adaptive.relocks)},
+        {"cpu_utilization", cpu_utilization},
+    };
+  } else {
+    runbench<R>(accessnum, path, storage, hooks,
+                schedule ? &*schedule : nullptr, options.reader);
+  }
 
-  std::cout << "[" << R::methodname() << "] postprocessing...\n";
+  if (schedule) {
+    auto deadlines = schedule->summary();
+    double cpu_utilization = measurementCpuUtilization(phases);
+
+    std::cout << "        Wakeup Lateness:   median " << deadlines.median_ns
+              << " ns, p99 " << deadlines.p99_ns << " ns, max "
+              << deadlines.max_ns << " ns\n"
+              << "        Missed Deadlines:  " << deadlines.missed << "\n"
+              << "        CPU Utilization:   " << cpu_utilization * 100
+              << " %\n\n";
+
+    metadata.deadlines[method] = {
+        {"lateness_mean_ns", deadlines.mean_ns},
+        {"lateness_median_ns", double(deadlines.median_ns)},
+        {"lateness_p99_ns", double(deadlines.p99_ns)},
+        {"lateness_max_ns", double(deadlines.max_ns)},
+        {"missed", double(deadlines.missed)},
+        {"cpu_utilization", cpu_utilization},
+    };
+  }
+
+  if (options.system_counters) {
+    auto total = counters.total();
+    std::cout << "        Context Switches:  "
+              << total.voluntary_ctxt_switches << " voluntary, "
+              << total.nonvoluntary_ctxt_switches << " involuntary\n"
+              << "        Interrupts:        " << total.interrupts
+              << " (" << total.cpu_interrupts << " on cpu " << counters.cpu()
+              << ")\n"
+              << "        Softirqs:          " << total.softirqs << " ("
+              << total.cpu_softirqs << " on cpu " << counters.cpu() << ")\n\n";
+  }
+
+  reportCounters(method, reader_stats, perf, storage.size(),
+                 metadata);
+
+  std::cout << "[" << method << "] postprocessing...\n";
+  phases.start("getvalueduration");
   time_reading_storage duration_value = getvalueduration(storage);
+  saveDerivedChannel(storage, method, options, metadata);
+
+  std::cout << "[" << method << "] saving...\n";
+  phases.start("save");
+  save(storage, duration_value, method, output_path);
+  if (options.system_counters) {
+    counters.save(counters_path);
+  }
+  if (schedule) {
+    schedule->save(deadlines_path);
+  }
+  phases.stop();
+
+  metadata.phases[method] = phases.phases();
+  if (options.phase_table) {
+    std::cout << "[" << method << "] phases:\n";
+    phases.print(std::cout, "        ");
+  }
+
+  std::cout << "[" << method << "] done\n\n";
+}
+
+/**
+ * records snapshots of all attributes of options.sensor_path (a chip
+ * directory) matching patterns, with user-facing output like
+ * runbenchWrapper()
+ */
+static void recordGroup(const RecordOptions& options,
+                        const std::string& patterns,
+                        Metadata& metadata) {
+  const auto output_path = options.output_path / fname_group_snapshots;
+  checkoutputfile(output_path);
+
+  PhaseTimer phases;
+  phases.start("sensor_init");
+  GroupReader reader(selectGroupAttributes(options.sensor_path, patterns));
+  std::cout << "[group] " << reader.size() << " attributes:";
+  for (const auto& name : reader.names()) {
+    std::cout << " " << name;
+  }
+  std::cout << "\n";
+
+  size_t snapshots = options.accessnum;
+  if (options.accesstime > 0) {
+    phases.start("estimate");
+    std::cout << "[group] estimating number of snapshots for " << options.accesstime << " s runtime...\n";
+    GroupStorage probe(reader.size(), 1);
+    size_t per_second = 0;
+    auto start = std::chrono::steady_clock::now();
+    while ((std::chrono::steady_clock::now() - start) < std::chrono::seconds{1}) {
+      benchmarkGroup(reader, 1, probe);
+      ++per_second;
+    }
+    snapshots = per_second * options.accesstime;
+    std::cout << "[group] will take " << snapshots << " snapshots\n";
+  }
+
+  phases.start("allocate");
+  GroupStorage storage(reader.size(), snapshots);
+
+  std::cout << "[group] starting benchmark...\n";
+  phases.start("warmup");
+  benchmarkGroup(reader, std::round(double(snapshots) / 10), storage);
+  phases.start("measurement");
+  benchmarkGroup(reader, snapshots, storage);
+  phases.stop();
+
+  if (storage.size() > 1) {
+    const auto& timestamps = storage.timestamps();
+    double runtime_s = double(timestamps.back() - timestamps.front()) / 1e9;
+    std::cout << "        Real Runtime:      " << runtime_s * 1000 << " ms\n"
+              << "        Snapshot Rate:     " << (storage.size() - 1) / runtime_s
+              << " /s (" << runtime_s * 1e9 / (storage.size() - 1) / reader.size()
+              << " ns per attribute)\n\n";
+  }
+
+  std::cout << "[group] saving...\n";
+  phases.start("save");
+  storage.save(output_path, reader.names());
+  phases.stop();
+
+  metadata.group_attributes = reader.names();
+  metadata.phases["group"] = phases.phases();
+  if (options.phase_table) {
+    std::cout << "[group] phases:\n";
+    phases.print(std::cout, "        ");
+  }
+  std::cout << "[group] done\n\n";
+}
+
+/**
+ * Collects the methods of record --concurrent and runs them at the same time,
+ * each in its own pinned thread (see runConcurrently()), so their readings of
+ * the same sensor share one timeline.
+ */
+class ConcurrentRecording {
+ private:
+  const RecordOptions& options_;
+  std::vector<std::string> methods_;
+  /// jobs refer to their storage, so storages must not move
+  std::list<time_reading_storage> storages_;
+  std::vector<ConcurrentJob> jobs_;
+
+ public:
+  ConcurrentRecording(const RecordOptions& options) : options_(options) {}
+
+  /**
+   * prepares the method of R, read with reader_options; with accesstime, its
+   * number of accesses is estimated on its own, before any concurrent access
+   */
+  template <Reader R>
+  void add(const ReaderOptions& reader_options) {
+    const std::string method = readerMethod<R>(reader_options);
+    checkalloutputfiles(method, options_.output_path);
+    if (options_.derive) {
+      checkoutputfile(options_.output_path / (method + fname_suffix_derived));
+    }
+
+    int accessnum = options_.accessnum;
+    if (options_.accesstime > 0) {
+      std::cout << "[" << method << "] estimating number of accesses for " << options_.accesstime << " s runtime...\n";
+      accessnum = benchmarkSec<R>(options_.sensor_path, reader_options) *
+                  options_.accesstime;
+      std::cout << "[" << method << "] will perform " << accessnum << " accesses\n";
+    }
+
+    storages_.emplace_back(accessnum);
+    jobs_.push_back(concurrentJob<R>(accessnum, options_.sensor_path,
+                                     storages_.back(), reader_options));
+    methods_.push_back(method);
+  }
+
+  /**
+   * runs all added methods at once and saves their readings
+   */
+  void run(Metadata& metadata) {
+    PhaseTimer phases;
+
+    std::cout << "[concurrent] starting benchmark of";
+    for (const auto& method : methods_) {
+      std::cout << " " << method;
+    }
+    std::cout << "...\n";
+    auto cpus = runConcurrently(jobs_, &phases);
+
+    phases.start("save");
+    auto storage = storages_.begin();
+    for (size_t i = 0; i < methods_.size(); ++i, ++storage) {
+      double runtime_ms =
+          storage->empty()
+              ? 0
+              : double(storage->back().first - storage->front().first) / 1e6;
+      std::cout << "[" << methods_[i] << "] cpu " << cpus[i] << "\n"
+                << "        Real Runtime:      " << runtime_ms << " ms\n\n";
+      metadata.concurrent_cpus[methods_[i]] = cpus[i];
+
+      std::cout << "[" << methods_[i] << "] postprocessing and saving...\n";
+      save(*storage, getvalueduration(*storage), methods_[i],
+           options_.output_path);
+      saveDerivedChannel(*storage, methods_[i], options_, metadata);
+    }
+    phases.stop();
+
+    metadata.phases["concurrent"] = phases.phases();
+    if (options_.phase_table) {
+      std::cout << "[concurrent] phases:\n";
+      phases.print(std::cout, "        ");
+    }
 
-  std::cout << "[" << R::methodname() << "] saving...\n";
-  save(storage, duration_value, R::methodname(), output_path);
+    std::cout << "[concurrent] done\n\n";
+  }
+};
 
-  std::cout << "[" << R::methodname() << "] done\n\n";
+/**
+ * records one method, either right away or as part of the concurrent run
+ */
+template <Reader R>
+static void recordMethod(const RecordOptions& options,
+                         Metadata& metadata,
+                         ConcurrentRecording& concurrent) {
+  if (options.concurrent) {
+    concurrent.add<R>(options.reader);
+  } else if (nullptr != options.reader.shm_ring) {
+    runbenchWrapper<ReaderShm<R>>(options, metadata);
+  } else {
+    runbenchWrapper<R>(options, metadata);
+  }
 }
 
 /**
@@ -449,6 +1751,7 @@ int recordSubcommand(argparse::ArgumentParser& record_command) {
   int accesstime = 0;
   std::filesystem::path output_path;
   std::filesystem::path path;
+  RecordOptions options;
 
   if (record_command.is_used("--accesstime") &&
       record_command.is_used("--accessnum")) {
@@ -482,6 +1785,190 @@ int recordSubcommand(argparse::ArgumentParser& record_command) {
   output_path = record_command.get<std::string>("--output");
   path = record_command.get<std::string>("SENSOR");
 
+  if (record_command.is_used("--system-counters-interval")) {
+    options.system_counters_interval_ms =
+        record_command.get<int>("--system-counters-interval");
+    if (options.system_counters_interval_ms <= 0) {
+      std::cerr << "system counter interval must be at least 1 ms\n";
+      return -1;
+    }
+  }
+  if (record_command.is_used("--rate")) {
+    options.rate_hz = record_command.get<int>("--rate");
+    if (options.rate_hz <= 0 || options.rate_hz > 1000000) {
+      std::cerr << "rate must be between 1 Hz and 1 MHz\n";
+      return -1;
+    }
+  }
+  options.adaptive = record_command.is_used("--adaptive");
+  if (options.adaptive && options.rate_hz > 0) {
+    std::cerr << "specify either --rate or --adaptive\n";
+    return -1;
+  }
+  if (record_command.is_used("--rate-spin-us")) {
+    if (0 == options.rate_hz) {
+      std::cerr << "--rate-spin-us requires --rate\n";
+      return -1;
+    }
+    options.rate_spin_us = record_command.get<int>("--rate-spin-us");
+    if (options.rate_spin_us < 0) {
+      std::cerr << "spin time must not be negative\n";
+      return -1;
+    }
+  }
+  if (record_command.is_used("--threads")) {
+    options.threads = record_command.get<int>("--threads");
+    if (options.threads <= 0 || options.threads > 1024) {
+      std::cerr << "number of threads must be between 1 and 1024\n";
+      return -1;
+    }
+    if (options.rate_hz > 0 || options.adaptive ||
+        record_command.is_used("--system-counters") ||
+        record_command.is_used("--system-counters-interval")) {
+      std::cerr << "--threads can not be combined with --rate, --adaptive or "
+                   "system counters\n";
+      return -1;
+    }
+  }
+  if (record_command.is_used("--group")) {
+    for (const auto* method : {"--sysfs", "--sysfs-lseek", "--libsensors",
+                               "--null", "--replay", "--poll", "--method"}) {
+      if (record_command.is_used(method)) {
+        std::cerr << "--group reads a chip directory and can not be combined "
+                     "with other readout methods\n";
+        return -1;
+      }
+    }
+    if (options.rate_hz > 0 || options.adaptive || options.threads > 0 ||
+        record_command.is_used("--concurrent") ||
+        record_command.is_used("--system-counters") ||
+        record_command.is_used("--system-counters-interval")) {
+      std::cerr << "--group can not be combined with --rate, --adaptive, "
+                   "--threads, --concurrent or system counters\n";
+      return -1;
+    }
+  }
+
+  options.derive = record_command.is_used("--derive") ||
+                   record_command.is_used("--derive-wrap");
+  if (record_command.is_used("--derive-wrap")) {
+    options.derive_wrap = record_command.get<double>("--derive-wrap");
+    if (options.derive_wrap <= 0) {
+      std::cerr << "wrap value must be positive\n";
+      return -1;
+    }
+    if (DerivedKind::power != DerivedChannel::kindFor(path)) {
+      std::cerr << "--derive-wrap applies to energy counters only\n";
+      return -1;
+    }
+  }
+  if (options.derive && record_command.is_used("--group")) {
+    std::cerr << "--derive can not be combined with --group\n";
+    return -1;
+  }
+
+  options.concurrent = record_command.is_used("--concurrent");
+  if (options.concurrent &&
+      (options.rate_hz > 0 || options.adaptive || options.threads > 0 ||
+       record_command.is_used("--system-counters") ||
+       record_command.is_used("--system-counters-interval"))) {
+    std::cerr << "--concurrent can not be combined with --rate, --adaptive, "
+                 "--threads or system counters\n";
+    return -1;
+  }
+
+  options.summary_only = record_command.is_used("--summary-only");
+  if (options.summary_only &&
+      (options.rate_hz > 0 || options.adaptive || options.threads > 0 ||
+       options.concurrent || options.derive ||
+       record_command.is_used("--group") ||
+       record_command.is_used("--system-counters") ||
+       record_command.is_used("--system-counters-interval"))) {
+    std::cerr << "--summary-only can not be combined with --rate, --adaptive, "
+                 "--threads, --concurrent, --derive, --group or system "
+                 "counters\n";
+    return -1;
+  }
+
+  // plugins stay loaded until all methods are recorded
+  std::list<PluginLibrary> plugin_libraries;
+  std::vector<const PluginLibrary*> plugin_methods;
+  try {
+    if (record_command.is_used("--plugin")) {
+      for (const auto& file :
+           record_command.get<std::vector<std::string>>("--plugin")) {
+        plugin_libraries.emplace_back(file);
+      }
+    }
+    if (record_command.is_used("--method")) {
+      const auto search_path = pluginSearchPath();
+      for (const auto& name :
+           record_command.get<std::vector<std::string>>("--method")) {
+        plugin_methods.push_back(
+            &findPlugin(name, plugin_libraries, search_path));
+      }
+    }
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << "\n";
+    return -1;
+  }
+
+  // consumers follow one stream of samples, so only one reader may publish
+  std::unique_ptr<ShmRingWriter> shm_ring;
+  if (record_command.is_used("--shm")) {
+    size_t methods = plugin_methods.size();
+    for (const auto* method : {"--sysfs", "--sysfs-lseek", "--libsensors",
+                               "--null", "--replay", "--poll"}) {
+      methods += record_command.is_used(method) ? 1 : 0;
+    }
+    if (1 != methods || options.threads > 0 || options.concurrent ||
+        record_command.is_used("--group")) {
+      std::cerr << "--shm publishes exactly one readout method and can not be "
+                   "combined with --threads, --concurrent or --group\n";
+      return -1;
+    }
+    const int capacity = record_command.get<int>("--shm-capacity");
+    if (capacity < 2 || capacity > (1 << 30)) {
+      std::cerr << "ring capacity must be between 2 and 2^30 samples\n";
+      return -1;
+    }
+    try {
+      shm_ring = std::make_unique<ShmRingWriter>(
+          record_command.get<std::string>("--shm"), capacity);
+    } catch (const std::runtime_error& e) {
+      std::cerr << e.what() << "\n";
+      return -1;
+    }
+    options.reader.shm_ring = shm_ring.get();
+  } else if (record_command.is_used("--shm-capacity")) {
+    std::cerr << "--shm-capacity requires --shm\n";
+    return -1;
+  }
+
+  std::vector<LoadSpec> load_specs;
+  if (record_command.is_used("--load")) {
+    try {
+      for (const auto& spec :
+           record_command.get<std::vector<std::string>>("--load")) {
+        load_specs.push_back(LoadSpec::parse(spec));
+      }
+    } catch (const std::runtime_error& e) {
+      std::cerr << e.what() << "\n";
+      return -1;
+    }
+  }
+  options.perf_counters = !record_command.is_used("--no-perf-counters");
+  options.phase_table = record_command.is_used("--phase-table");
+  options.reader.replay_timing = record_command.is_used("--replay-timing");
+  options.reader.poll_timeout_ms =
+      record_command.get<int>("--poll-timeout-ms");
+  if (options.reader.poll_timeout_ms <= 0) {
+    std::cerr << "poll timeout must be at least 1 ms\n";
+    return -1;
+  }
+  options.system_counters = record_command.is_used("--system-counters") ||
+                            record_command.is_used("--system-counters-interval");
+
   // if output directory doesnt exist: create it
   if (!std::filesystem::exists(output_path)) {
     bool created = std::filesystem::create_directories(output_path);
@@ -492,6 +1979,10 @@ int recordSubcommand(argparse::ArgumentParser& record_command) {
   }
 
   std::cout << "Path: " << path << "\n";
+  if (shm_ring) {
+    std::cout << "Publishing to: " << shm_ring->name() << " ("
+              << shm_ring->capacity() << " samples)\n";
+  }
 
   // prepare metadata beforehand, but dump *after* experiments
   const auto metadata_path =
@@ -512,32 +2003,96 @@ int recordSubcommand(argparse::ArgumentParser& record_command) {
     if (0 != accesstime) {
       metadata.accesstime_s = accesstime;
     }
+    if (options.system_counters) {
+      metadata.system_counters_interval_ms =
+          options.system_counters_interval_ms;
+    }
+    if (record_command.is_used("--poll")) {
+      metadata.poll_timeout_ms = options.reader.poll_timeout_ms;
+    }
+    if (options.threads > 0) {
+      metadata.threads = options.threads;
+    }
+    if (options.rate_hz > 0) {
+      metadata.rate_hz = options.rate_hz;
+      metadata.rate_spin_us = options.rate_spin_us;
+    }
+    if (shm_ring) {
+      metadata.shm_ring = shm_ring->name();
+      metadata.shm_ring_capacity = shm_ring->capacity();
+    }
 
     metadata.autofill();
   }
 
+  options.accessnum = accessnum;
+  options.accesstime = accesstime;
+  options.sensor_path = path;
+  options.output_path = output_path;
+
+  LoadGenerator load(load_specs);
+  ConcurrentRecording concurrent(options);
   try {
+    if (!load_specs.empty()) {
+      std::cout << "Starting background load...\n";
+      load.start();
+    }
+
     // check what methods were used
+    if (record_command.is_used("--group")) {
+      recordGroup(options, record_command.get<std::string>("--group"),
+                  metadata);
+    }
     if (record_command.is_used("--sysfs")) {
-      runbenchWrapper<ReaderSysfs>(accessnum, accesstime, path, output_path);
+      recordMethod<ReaderSysfs>(options, metadata, concurrent);
     }
     if (record_command.is_used("--sysfs-lseek")) {
-      runbenchWrapper<ReaderLseek>(accessnum, accesstime, path, output_path);
+      recordMethod<ReaderLseek>(options, metadata, concurrent);
     }
     if (record_command.is_used("--libsensors")) {
-      runbenchWrapper<ReaderLibsens>(accessnum, accesstime, path, output_path);
+      recordMethod<ReaderLibsens>(options, metadata, concurrent);
     }
     if (record_command.is_used("--null")) {
-      runbenchWrapper<ReaderNull>(accessnum, accesstime, path, output_path);
+      recordMethod<ReaderNull>(options, metadata, concurrent);
+    }
+    if (record_command.is_used("--replay")) {
+      recordMethod<ReaderReplay>(options, metadata, concurrent);
+    }
+    if (record_command.is_used("--poll")) {
+      recordMethod<ReaderPoll>(options, metadata, concurrent);
+    }
+    for (const auto* library : plugin_methods) {
+      RecordOptions plugin_options = options;
+      plugin_options.reader.plugin = &library->plugin();
+      metadata.plugins[library->plugin().name] = library->path().string();
+      recordMethod<ReaderPlugin>(plugin_options, metadata, concurrent);
     }
     if (!(record_command.is_used("--sysfs") ||
           record_command.is_used("--sysfs-lseek") ||
           record_command.is_used("--libsensors") ||
-          record_command.is_used("--null"))) {
+          record_command.is_used("--null") ||
+          record_command.is_used("--replay") ||
+          record_command.is_used("--poll") ||
+          record_command.is_used("--group") || !plugin_methods.empty())) {
       std::cerr << "Select at least one readout method from --sysfs, "
-                   "--sysfs-lseek, --libsensors, or --null (see --help)\n";
+                   "--sysfs-lseek, --libsensors, --null, --replay, --poll, "
+                   "--method or --group (see --help)\n";
       return -1;
     }
+    if (options.concurrent) {
+      concurrent.run(metadata);
+    }
+
+    if (!load_specs.empty()) {
+      load.stop();
+      metadata.load = load.profile();
+      std::cout << "Background load:\n";
+      for (const auto& profile : metadata.load) {
+        std::cout << "        " << std::left << std::setw(19)
+                  << profile.kind + ":" << std::right << profile.rate << " "
+                  << profile.unit << "/s on cpus " << profile.cpus << "\n";
+      }
+    }
 
   } catch (const std::runtime_error& e) {
     std::cerr << e.what() << "\n";
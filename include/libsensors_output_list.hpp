@@ -16,6 +16,10 @@ struct libsensors_item {
   const sensors_subfeature_type subfeature_type;
 };
 
+/**
+ * all sensors known to libsensors, sensors_init() must have been called (see
+ * LibsensorsSession)
+ */
 class SensorList {
  public:
   std::vector<libsensors_item> sensors;
@@ -60,14 +64,14 @@ class SensorList {
     }
   }
 
-  void checknosensors() {
+  void checknosensors() const {
     if (sensors.size() == 0) {
       throw std::runtime_error("no sensors found");
     }
   }
 
   // outputs all sensors with features and subfeatures
-  void outputSensorList() {
+  void outputSensorList() const {
     std::cout << "full_path;chip_path;subfeature;feature\n";
 
     for (const auto& chip_item : sensors) {
@@ -81,17 +85,6 @@ class SensorList {
   }
 };
 
-int printSensorList() {
-  // has to be called for sensors to be found
-  sensors_init(nullptr);
-
-  SensorList list;
-
-  list.outputSensorList();
-
-  return 0;
-}
-
 /*
 for future reference:
 
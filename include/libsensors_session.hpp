@@ -0,0 +1,114 @@
+#pragma once
+
+#include <sensors/sensors.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include <libsensors_output_list.hpp>
+
+/**
+ * Process-wide libsensors state, shared by all users.
+ *
+ * libsensors keeps global state: sensors_init() and sensors_cleanup() must
+ * not be called by every reader, or readers could not coexist. The session
+ * initializes libsensors when it is first acquired and cleans up once the
+ * last user released it, both under one lock, so a new session can not be
+ * initialized while the last one is still cleaning up. All sensors are
+ * enumerated once and indexed by their sysfs path, so looking up a sensor does
+ * not depend on the number of chips.
+ */
+class LibsensorsSession {
+ public:
+  /// what sensors_get_value() needs to read one sensor
+  struct Item {
+    const sensors_chip_name* chip;
+    int subfeature;
+  };
+
+ private:
+  static inline std::mutex mutex_;
+  /// the session while it has users, guarded by mutex_
+  static inline LibsensorsSession* current_ = nullptr;
+  static inline size_t users_ = 0;
+
+  /// initializes libsensors before list_ is filled
+  bool initialized_;
+  SensorList list_;
+  std::unordered_map<std::string, Item> index_;
+
+  static bool init() {
+    if (0 != sensors_init(nullptr)) {
+      throw std::runtime_error("could not initialize libsensors");
+    }
+    return true;
+  }
+
+  LibsensorsSession() : initialized_(init()) {
+    index_.reserve(list_.sensors.size());
+    for (const auto& sensor : list_.sensors) {
+      index_.emplace(sensor.chip_path + "/" + sensor.subfeature_name,
+                     Item{sensor.chip_name, sensor.subfeature_num});
+    }
+  }
+
+ public:
+  LibsensorsSession(const LibsensorsSession&) = delete;
+  LibsensorsSession& operator=(const LibsensorsSession&) = delete;
+
+  /**
+   * @returns the current session, initializing libsensors if there is none
+   * @throws std::runtime_error if libsensors can not be initialized
+   */
+  static std::shared_ptr<LibsensorsSession> acquire() {
+    std::lock_guard lock(mutex_);
+    if (nullptr == current_) {
+      current_ = new LibsensorsSession();
+    }
+    ++users_;
+    return std::shared_ptr<LibsensorsSession>(
+        current_, [](LibsensorsSession*) { release(); });
+  }
+
+  /**
+   * @param path sysfs path like /sys/class/hwmon/hwmon5/temp1_input
+   * @throws std::runtime_error if libsensors does not know the sensor
+   */
+  Item find(const std::string& path) const {
+    auto item = index_.find(path);
+    if (index_.end() == item) {
+      throw std::runtime_error("could not find sensors (total " +
+                               std::to_string(index_.size()) +
+                               " sensors availabel)");
+    }
+    return item->second;
+  }
+
+  /// @returns all sensors known to libsensors
+  const SensorList& list() const { return list_; }
+
+  ~LibsensorsSession() { sensors_cleanup(); }
+
+ private:
+  /// called once per acquire(), the last call cleans up libsensors
+  static void release() {
+    std::lock_guard lock(mutex_);
+    if (0 == --users_) {
+      delete current_;
+      current_ = nullptr;
+    }
+  }
+};
+
+/**
+ * prints all sensors known to libsensors, see SensorList::outputSensorList()
+ */
+int printSensorList() {
+  auto session = LibsensorsSession::acquire();
+
+  session->list().outputSensorList();
+
+  return 0;
+}
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <contention.hpp>
+
+/**
+ * kind of background work of one load thread
+ */
+enum class LoadKind {
+  /// busy loop without memory traffic, occupies the core
+  spin,
+  /// writes a buffer much larger than the caches, occupies memory bandwidth
+  membw,
+  /// cheap system calls in a loop, occupies kernel entry/exit paths
+  syscall,
+};
+
+/**
+ * @returns name of kind as used on the command line
+ */
+static std::string loadKindName(LoadKind kind) {
+  switch (kind) {
+    case LoadKind::spin:
+      return "spin";
+    case LoadKind::membw:
+      return "membw";
+    case LoadKind::syscall:
+      return "syscall";
+  }
+  return "unknown";
+}
+
+/**
+ * @returns unit of the operations counted for kind
+ */
+static std::string loadKindUnit(LoadKind kind) {
+  switch (kind) {
+    case LoadKind::spin:
+      return "iterations";
+    case LoadKind::membw:
+      return "bytes";
+    case LoadKind::syscall:
+      return "syscalls";
+  }
+  return "operations";
+}
+
+/**
+ * parses a cpu list like "0-3,6"
+ * @returns cpus in ascending order without duplicates
+ * @throws std::runtime_error on syntax errors or empty lists
+ */
+static std::vector<int> parseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  std::stringstream stream(list);
+  std::string range;
+  while (std::getline(stream, range, ',')) {
+    int first = 0;
+    int last = 0;
+    char dash = 0;
+    char rest = 0;
+    int fields =
+        std::sscanf(range.c_str(), "%d%c%d%c", &first, &dash, &last, &rest);
+    if (1 == fields) {
+      last = first;
+    } else if (3 != fields || '-' != dash) {
+      throw std::runtime_error("invalid cpu list: " + list);
+    }
+    if (first < 0 || last < first) {
+      throw std::runtime_error("invalid cpu range: " + range);
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  if (cpus.empty()) {
+    throw std::runtime_error("empty cpu list");
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+/**
+ * @returns cpus as compact list like "0-3,6"
+ */
+static std::string formatCpuList(const std::vector<int>& cpus) {
+  std::string result;
+  for (size_t i = 0; i < cpus.size();) {
+    size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+      ++j;
+    }
+    if (!result.empty()) {
+      result += ",";
+    }
+    result += std::to_string(cpus[i]);
+    if (j > i) {
+      result += "-" + std::to_string(cpus[j]);
+    }
+    i = j + 1;
+  }
+  return result;
+}
+
+/**
+ * one kind of load on a set of cpus, one thread per cpu
+ */
+struct LoadSpec {
+  LoadKind kind;
+  std::vector<int> cpus;
+
+  /**
+   * parses "KIND:CPUS", e.g. "membw:2-3"
+   * @throws std::runtime_error on unknown kinds or invalid cpu lists
+   */
+  static LoadSpec parse(const std::string& spec) {
+    auto colon = spec.find(':');
+    if (std::string::npos == colon) {
+      throw std::runtime_error("load must be given as KIND:CPUS, got " + spec);
+    }
+
+    std::string name = spec.substr(0, colon);
+    LoadSpec result;
+    if ("spin" == name) {
+      result.kind = LoadKind::spin;
+    } else if ("membw" == name) {
+      result.kind = LoadKind::membw;
+    } else if ("syscall" == name) {
+      result.kind = LoadKind::syscall;
+    } else {
+      throw std::runtime_error("unknown load kind (spin, membw, syscall): " +
+                               name);
+    }
+    result.cpus = parseCpuList(spec.substr(colon + 1));
+    return result;
+  }
+};
+
+/**
+ * achieved load of one LoadSpec, as stored in the metadata
+ */
+struct LoadProfile {
+  std::string kind;
+  std::string cpus;
+  std::string unit;
+  /// operations per second, summed over all threads of this spec
+  double rate = 0;
+};
+
+/**
+ * Runs background load threads pinned to the given cpus between start() and
+ * stop(), counting the work done to document how heavy the load was.
+ */
+class LoadGenerator {
+ private:
+  /// per thread membw buffer, well beyond typical last level caches
+  static constexpr size_t membw_buffer_size = 64 * 1024 * 1024;
+
+  std::vector<LoadSpec> specs_;
+  std::atomic<bool> stop_ = false;
+  /// threads which are pinned and about to start working
+  std::atomic<size_t> ready_ = 0;
+  std::vector<std::thread> threads_;
+  /// operations of every thread, in order of specs_ and their cpus
+  std::unique_ptr<std::atomic<uint64_t>[]> operations_;
+  std::vector<std::exception_ptr> errors_;
+  std::chrono::steady_clock::time_point start_;
+  double seconds_ = 0;
+
+  void work(LoadKind kind, int cpu, std::atomic<uint64_t>& operations,
+            std::exception_ptr& error) {
+    try {
+      pinCurrentThread(cpu);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    ++ready_;
+    if (error) {
+      return;
+    }
+
+    try {
+      uint64_t done = 0;
+      if (LoadKind::spin == kind) {
+        volatile uint64_t sink = 0;
+        while (!stop_.load(std::memory_order_relaxed)) {
+          for (int i = 0; i < 1000; ++i) {
+            sink = sink + i;
+          }
+          done += 1000;
+        }
+      } else if (LoadKind::membw == kind) {
+        // allocated here, so the pages are local to the pinned cpu
+        std::vector<char> buffer(membw_buffer_size);
+        for (char fill = 0; !stop_.load(std::memory_order_relaxed); ++fill) {
+          std::memset(buffer.data(), fill, buffer.size());
+          done += buffer.size();
+        }
+      } else {
+        while (!stop_.load(std::memory_order_relaxed)) {
+          // not cached by the libc, always enters the kernel
+          getppid();
+          ++done;
+        }
+      }
+      operations = done;
+    } catch (...) {
+      error = std::current_exception();
+    }
+  }
+
+ public:
+  LoadGenerator(std::vector<LoadSpec> specs) : specs_(std::move(specs)) {}
+
+  LoadGenerator(const LoadGenerator&) = delete;
+  LoadGenerator& operator=(const LoadGenerator&) = delete;
+
+  /**
+   * starts one thread per cpu of every spec and waits until all of them run
+   * @throws std::runtime_error if a cpu is not available to this process or
+   * a thread could not be pinned
+   */
+  void start() {
+    const auto allowed = allowedCpus();
+    size_t count = 0;
+    for (const auto& spec : specs_) {
+      for (int cpu : spec.cpus) {
+        if (!std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+          throw std::runtime_error("cpu " + std::to_string(cpu) +
+                                   " is not available for load");
+        }
+      }
+      count += spec.cpus.size();
+    }
+
+    stop_ = false;
+    ready_ = 0;
+    operations_ = std::make_unique<std::atomic<uint64_t>[]>(count);
+    errors_.assign(count, nullptr);
+    start_ = std::chrono::steady_clock::now();
+
+    size_t index = 0;
+    for (const auto& spec : specs_) {
+      for (int cpu : spec.cpus) {
+        threads_.emplace_back(&LoadGenerator::work, this, spec.kind, cpu,
+                              std::ref(operations_[index]),
+                              std::ref(errors_[index]));
+        ++index;
+      }
+    }
+
+    while (ready_ < count) {
+      std::this_thread::yield();
+    }
+    for (const auto& error : errors_) {
+      if (error) {
+        // stops the others and rethrows
+        stop();
+      }
+    }
+  }
+
+  /**
+   * stops and joins all threads
+   * @throws the first exception of a load thread
+   */
+  void stop() {
+    if (threads_.empty()) {
+      return;
+    }
+
+    stop_ = true;
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+    seconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                             start_)
+                   .count();
+
+    for (const auto& error : errors_) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+
+  /**
+   * @returns load achieved per spec between the last start() and stop()
+   */
+  std::vector<LoadProfile> profile() const {
+    std::vector<LoadProfile> result;
+    size_t index = 0;
+    for (const auto& spec : specs_) {
+      uint64_t operations = 0;
+      for (size_t i = 0; i < spec.cpus.size(); ++i) {
+        operations += operations_ ? operations_[index].load() : 0;
+        ++index;
+      }
+      result.push_back({
+          .kind = loadKindName(spec.kind),
+          .cpus = formatCpuList(spec.cpus),
+          .unit = loadKindUnit(spec.kind),
+          .rate = seconds_ > 0 ? operations / seconds_ : 0,
+      });
+    }
+    return result;
+  }
+
+  ~LoadGenerator() {
+    try {
+      stop();
+    } catch (...) {
+      // already stopped on error, nothing left to report
+    }
+  }
+};
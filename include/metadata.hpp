@@ -9,6 +9,7 @@
 #include <chrono>
 #include <iomanip>
 #include <ctime>
+#include <map>
 #include <optional>
 
 extern "C" {
@@ -18,6 +19,9 @@ extern "C" {
 
 #include <toml++/toml.hpp>
 
+#include <load_generator.hpp>
+#include <phase_timer.hpp>
+
 #include <libcpuid/libcpuid.h>
 
 static cpu_id_t get_cpu_info() {
@@ -49,6 +53,22 @@ static std::string generate_uuid() {
   return std::string(uuid_str);
 }
 
+/**
+ * @returns table of tables, e.g. method -> counter name -> value
+ */
+static toml::table to_toml_table(
+    const std::map<std::string, std::map<std::string, double>>& values) {
+  toml::table result;
+  for (const auto& [outer, inner] : values) {
+    toml::table inner_table;
+    for (const auto& [name, value] : inner) {
+      inner_table.insert(name, value);
+    }
+    result.insert(outer, inner_table);
+  }
+  return result;
+}
+
 /**
  * Contains Metadata associated to one measurement.
  * The intended workflow is as followed:
@@ -72,6 +92,65 @@ public:
   /// (desired) time limit in second
   std::optional<int> accesstime_s;
 
+  /// interval of system counter sampling in ms (0: before/after only), only
+  /// present if system counters were recorded
+  std::optional<int> system_counters_interval_ms;
+
+  /// perf counter averages per sensor access, by method and counter name
+  std::map<std::string, std::map<std::string, double>> perf_per_access;
+
+  /// whether perf counters include kernel time (false: user space only)
+  bool perf_kernel_included = true;
+
+  /// resource usage of each phase of the record run, by method
+  std::map<std::string, std::vector<PhaseTiming>> phases;
+
+  /// accesses per second (if recorded with --rate, otherwise null)
+  std::optional<int> rate_hz;
+
+  /// busy-wait time before each deadline in us (only with rate_hz)
+  std::optional<int> rate_spin_us;
+
+  /// wakeup lateness and cpu utilization of fixed-rate runs, by method
+  std::map<std::string, std::map<std::string, double>> deadlines;
+
+  /// change detection and cpu utilization of adaptive runs, by method
+  std::map<std::string, std::map<std::string, double>> adaptive;
+
+  /// number of concurrent readers per method (only if used)
+  std::optional<int> threads;
+
+  /// throughput by method and access latencies by thread ("<method>-t<i>")
+  std::map<std::string, std::map<std::string, double>> contention;
+
+  /// summary of the derived channel, by method
+  std::map<std::string, std::map<std::string, double>> derived;
+
+  /// access and value statistics of record --summary-only, by method
+  std::map<std::string, std::map<std::string, double>> summary;
+
+  /// attributes of record --group, in column order
+  std::vector<std::string> group_attributes;
+
+  /// cpu of every method of a concurrent run (only if used)
+  std::map<std::string, int> concurrent_cpus;
+
+  /// shared object of every plugin method (only if used)
+  std::map<std::string, std::string> plugins;
+
+  /// background load running during all measurements
+  std::vector<LoadProfile> load;
+
+  /// fallback interval of the poll method (only if used)
+  std::optional<int> poll_timeout_ms;
+
+  /// shared memory ring the samples were published to (only if used)
+  std::optional<std::string> shm_ring;
+  std::optional<int> shm_ring_capacity;
+
+  /// events counted by the readers during the measurement, by method
+  std::map<std::string, std::map<std::string, double>> reader_stats;
+
   /// start of experiment
   std::chrono::system_clock::time_point start_datetime;
 
@@ -158,6 +237,113 @@ public:
       doc_root.emplace("accesstime_s", *accesstime_s);
     }
 
+    if (!perf_per_access.empty()) {
+      toml::table perf = to_toml_table(perf_per_access);
+      perf.insert("kernel_included", perf_kernel_included);
+      doc_root.emplace("perf_per_access", perf);
+    }
+
+    if (!phases.empty()) {
+      toml::table phases_table;
+      for (const auto& [method, timings] : phases) {
+        toml::array method_phases;
+        for (const auto& timing : timings) {
+          method_phases.push_back(toml::table{
+              {"name", timing.name},
+              {"wall_s", timing.wall_s},
+              {"cpu_s", timing.cpu_s},
+              {"peak_rss_kib", int64_t(timing.peak_rss_kib)},
+          });
+        }
+        phases_table.insert(method, method_phases);
+      }
+      doc_root.emplace("phases", phases_table);
+    }
+
+    if (system_counters_interval_ms) {
+      doc_root.emplace("system_counters_interval_ms",
+                       *system_counters_interval_ms);
+    }
+
+    if (rate_hz) {
+      doc_root.emplace("rate_hz", *rate_hz);
+      doc_root.emplace("rate_spin_us", rate_spin_us.value_or(0));
+    }
+
+    if (!deadlines.empty()) {
+      doc_root.emplace("deadlines", to_toml_table(deadlines));
+    }
+
+    if (!adaptive.empty()) {
+      doc_root.emplace("adaptive", to_toml_table(adaptive));
+    }
+
+    if (threads) {
+      doc_root.emplace("threads", *threads);
+    }
+
+    if (!contention.empty()) {
+      doc_root.emplace("contention", to_toml_table(contention));
+    }
+
+    if (!derived.empty()) {
+      doc_root.emplace("derived", to_toml_table(derived));
+    }
+
+    if (!summary.empty()) {
+      doc_root.emplace("summary", to_toml_table(summary));
+    }
+
+    if (!group_attributes.empty()) {
+      toml::array attributes;
+      for (const auto& name : group_attributes) {
+        attributes.push_back(name);
+      }
+      doc_root.emplace("group_attributes", attributes);
+    }
+
+    if (!concurrent_cpus.empty()) {
+      toml::table cpus_table;
+      for (const auto& [method, cpu] : concurrent_cpus) {
+        cpus_table.insert(method, cpu);
+      }
+      doc_root.emplace("concurrent_cpus", cpus_table);
+    }
+
+    if (!plugins.empty()) {
+      toml::table plugins_table;
+      for (const auto& [method, file] : plugins) {
+        plugins_table.insert(method, file);
+      }
+      doc_root.emplace("plugins", plugins_table);
+    }
+
+    if (!load.empty()) {
+      toml::array load_array;
+      for (const auto& profile : load) {
+        load_array.push_back(toml::table{
+            {"kind", profile.kind},
+            {"cpus", profile.cpus},
+            {"unit", profile.unit},
+            {"rate_per_s", profile.rate},
+        });
+      }
+      doc_root.emplace("load", load_array);
+    }
+
+    if (poll_timeout_ms) {
+      doc_root.emplace("poll_timeout_ms", *poll_timeout_ms);
+    }
+
+    if (shm_ring) {
+      doc_root.emplace("shm_ring", *shm_ring);
+      doc_root.emplace("shm_ring_capacity", shm_ring_capacity.value_or(0));
+    }
+
+    if (!reader_stats.empty()) {
+      doc_root.emplace("reader_stats", to_toml_table(reader_stats));
+    }
+
     f << doc_root;
   }
 };
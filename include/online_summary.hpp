@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+static const std::string fname_suffix_histogram = "_histogram.csv";
+
+/**
+ * Histogram of nanosecond durations with fixed memory: values below 64 get a
+ * bucket each, above that every power of two is split into 32 linear
+ * buckets, so any value is known to within 1/32 (3 %) of itself.
+ *
+ * Recording is a few instructions without allocation, so it can be done in
+ * the sampling loop.
+ */
+class LogLinearHistogram {
+ public:
+  /// linear buckets per power of two, and the limit of exact buckets / 2
+  static constexpr unsigned sub_buckets = 32;
+  static constexpr unsigned sub_bits = std::countr_zero(sub_buckets);
+  /// exact buckets [0, 2 * sub_buckets), then 32 per power of two up to 2^64
+  static constexpr size_t bucket_count =
+      2 * sub_buckets + (64 - sub_bits - 1) * sub_buckets;
+
+ private:
+  std::array<uint64_t, bucket_count> counts_ = {};
+  uint64_t total_ = 0;
+  uint64_t min_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_ = 0;
+  double sum_ = 0;
+
+ public:
+  /// @returns bucket of value
+  static size_t bucketOf(uint64_t value) {
+    if (value < 2 * sub_buckets) {
+      return value;
+    }
+    // value has exponent + 1 significant bits, the sub_bits after the
+    // leading one select the linear bucket
+    const unsigned exponent = 63 - std::countl_zero(value);
+    const unsigned shift = exponent - sub_bits;
+    return shift * sub_buckets + (value >> shift);
+  }
+
+  /// @returns smallest value of bucket
+  static uint64_t lowerBound(size_t bucket) {
+    if (bucket < 2 * sub_buckets) {
+      return bucket;
+    }
+    const unsigned shift = bucket / sub_buckets - 1;
+    return uint64_t(sub_buckets + bucket % sub_buckets) << shift;
+  }
+
+  /// @returns largest value of bucket
+  static uint64_t upperBound(size_t bucket) {
+    if (bucket + 1 == bucket_count) {
+      return std::numeric_limits<uint64_t>::max();
+    }
+    return lowerBound(bucket + 1) - 1;
+  }
+
+  void record(uint64_t value) {
+    ++counts_[bucketOf(value)];
+    ++total_;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += value;
+  }
+
+  uint64_t count() const { return total_; }
+  uint64_t count(size_t bucket) const { return counts_[bucket]; }
+  uint64_t min() const { return total_ > 0 ? min_ : 0; }
+  uint64_t max() const { return max_; }
+  double mean() const { return total_ > 0 ? sum_ / total_ : 0; }
+
+  /**
+   * @param quantile in [0, 1], e.g. 0.99
+   * @returns upper bound of the bucket holding the value at sorted index
+   * size * quantile (like accessLatencies() picks the median), within min and
+   * max, 0 if empty
+   */
+  uint64_t quantile(double quantile) const {
+    if (0 == total_) {
+      return 0;
+    }
+    const uint64_t rank =
+        std::min<uint64_t>(total_ * quantile, total_ - 1) + 1;
+    if (1 == rank) {
+      return min_;
+    }
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+      seen += counts_[bucket];
+      if (seen >= rank) {
+        return std::clamp(upperBound(bucket), min(), max_);
+      }
+    }
+    return max_;
+  }
+};
+
+/**
+ * Summarizes a series of timestamp;value samples as they are taken, in fixed
+ * memory: the time between consecutive accesses, how often the value changed
+ * and how long each value lasted (like getvalueduration()).
+ */
+class OnlineSampleSummary {
+ private:
+  LogLinearHistogram access_;
+  LogLinearHistogram value_duration_;
+  uint64_t samples_ = 0;
+  uint64_t changes_ = 0;
+  uint64_t first_timestamp_ = 0;
+  uint64_t last_timestamp_ = 0;
+  double last_value_ = 0;
+  /// the next sample does not follow the last one directly
+  bool gap_ = false;
+  /// last timestamp of the value before the current one, if there was one
+  bool previous_run_ = false;
+  uint64_t previous_run_end_ = 0;
+  double value_min_ = std::numeric_limits<double>::infinity();
+  double value_max_ = -std::numeric_limits<double>::infinity();
+  double value_mean_ = 0;
+
+ public:
+  void push(uint64_t timestamp, double value) {
+    if (samples_ > 0) {
+      if (!gap_) {
+        access_.record(timestamp - last_timestamp_);
+      }
+      if (value != last_value_) {
+        ++changes_;
+        // the value that just ended lasted from the end of its predecessor
+        if (previous_run_) {
+          value_duration_.record(last_timestamp_ - previous_run_end_);
+        }
+        previous_run_ = true;
+        previous_run_end_ = last_timestamp_;
+      }
+    } else {
+      first_timestamp_ = timestamp;
+    }
+
+    ++samples_;
+    gap_ = false;
+    last_timestamp_ = timestamp;
+    last_value_ = value;
+    value_min_ = std::min(value_min_, value);
+    value_max_ = std::max(value_max_, value);
+    value_mean_ += (value - value_mean_) / samples_;
+  }
+
+  /**
+   * marks that other work was done since the last sample, so the time to the
+   * next one is not an access time; value changes are still followed
+   */
+  void gap() { gap_ = true; }
+
+  /// time between consecutive accesses, except across gaps
+  const LogLinearHistogram& access() const { return access_; }
+
+  /**
+   * duration of every value but the first, which may have started before
+   * the recording; the last one is included, as getvalueduration() does
+   */
+  LogLinearHistogram valueDuration() const {
+    auto durations = value_duration_;
+    if (previous_run_) {
+      durations.record(last_timestamp_ - previous_run_end_);
+    }
+    return durations;
+  }
+
+  uint64_t samples() const { return samples_; }
+  uint64_t changes() const { return changes_; }
+  uint64_t runtime_ns() const { return last_timestamp_ - first_timestamp_; }
+
+  /// @returns summary as stored in the metadata
+  std::map<std::string, double> toMap() const {
+    const auto durations = valueDuration();
+    std::map<std::string, double> summary = {
+        {"samples", double(samples_)},
+        {"runtime_ns", double(runtime_ns())},
+        {"access_mean_ns", access_.mean()},
+        {"access_min_ns", double(access_.min())},
+        {"access_median_ns", double(access_.quantile(0.5))},
+        {"access_p90_ns", double(access_.quantile(0.9))},
+        {"access_p99_ns", double(access_.quantile(0.99))},
+        {"access_p999_ns", double(access_.quantile(0.999))},
+        {"access_max_ns", double(access_.max())},
+        {"changes", double(changes_)},
+        {"value_duration_median_ns", double(durations.quantile(0.5))},
+        {"value_duration_p99_ns", double(durations.quantile(0.99))},
+        {"value_duration_max_ns", double(durations.max())},
+    };
+    if (samples_ > 0) {
+      summary["value_min"] = value_min_;
+      summary["value_max"] = value_max_;
+      summary["value_mean"] = value_mean_;
+    }
+    return summary;
+  }
+
+  /**
+   * writes the non-empty buckets of both histograms as CSV
+   * @throws std::runtime_error if the file can not be written
+   */
+  void save(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+      throw std::runtime_error("could not open histogram file: " +
+                               path.string());
+    }
+
+    file << "histogram,lower_ns,upper_ns,count\n";
+    const auto durations = valueDuration();
+    for (const auto& [name, histogram] :
+         {std::pair{"access", &access_},
+          std::pair{"value_duration", &durations}}) {
+      for (size_t b = 0; b < LogLinearHistogram::bucket_count; ++b) {
+        if (histogram->count(b) > 0) {
+          file << name << "," << LogLinearHistogram::lowerBound(b) << ","
+               << LogLinearHistogram::upperBound(b) << ","
+               << histogram->count(b) << "\n";
+        }
+      }
+    }
+  }
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * One group of perf events, counted for the calling thread only.
+ * All events of a group are enabled and disabled at the very same time, so
+ * their ratios (e.g. instructions per cycle) are consistent.
+ *
+ * Events which can not be opened (e.g. hardware counters inside a VM) are
+ * skipped silently, check available() and the names returned by read().
+ */
+class PerfEventGroup {
+ private:
+  struct Event {
+    std::string name;
+    int fd;
+  };
+
+  std::vector<Event> events_;
+  bool exclude_kernel_;
+
+  int leader() const { return events_.empty() ? -1 : events_.front().fd; }
+
+ public:
+  /**
+   * @param exclude_kernel only count user space, required if
+   * /proc/sys/kernel/perf_event_paranoid forbids kernel profiling
+   */
+  PerfEventGroup(bool exclude_kernel) : exclude_kernel_(exclude_kernel) {}
+
+  PerfEventGroup(const PerfEventGroup&) = delete;
+  PerfEventGroup& operator=(const PerfEventGroup&) = delete;
+
+  /**
+   * opens an event and adds it to the group, the first one becomes leader
+   * @returns true on success, false if the event is not available
+   */
+  bool add(const std::string& name, uint32_t type, uint64_t config) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    // siblings follow the leader
+    attr.disabled = events_.empty() ? 1 : 0;
+    attr.exclude_kernel = exclude_kernel_ ? 1 : 0;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader(), 0);
+    if (fd < 0) {
+      return false;
+    }
+
+    events_.push_back({name, fd});
+    return true;
+  }
+
+  bool available() const { return !events_.empty(); }
+
+  /// resets and starts all counters of the group
+  void enable() {
+    if (!available()) {
+      return;
+    }
+    ioctl(leader(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  /// stops all counters of the group
+  void disable() {
+    if (!available()) {
+      return;
+    }
+    ioctl(leader(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  /// starts all counters of the group again without resetting them
+  void resume() {
+    if (!available()) {
+      return;
+    }
+    ioctl(leader(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  /**
+   * @returns counter values by name, scaled up if the group was multiplexed;
+   * empty if the group was never scheduled on the PMU
+   */
+  std::map<std::string, double> read() const {
+    std::map<std::string, double> result;
+    if (!available()) {
+      return result;
+    }
+
+    // nr, time_enabled, time_running, one value per event
+    std::vector<uint64_t> buffer(3 + events_.size());
+    ssize_t expected = buffer.size() * sizeof(uint64_t);
+    if (::read(leader(), buffer.data(), expected) != expected) {
+      return result;
+    }
+
+    uint64_t time_enabled = buffer[1];
+    uint64_t time_running = buffer[2];
+    if (0 == time_running) {
+      return result;
+    }
+
+    double scale = double(time_enabled) / double(time_running);
+    for (size_t i = 0; i < events_.size() && i < buffer[0]; ++i) {
+      result[events_[i].name] = double(buffer[3 + i]) * scale;
+    }
+
+    return result;
+  }
+
+  ~PerfEventGroup() {
+    for (const auto& event : events_) {
+      close(event.fd);
+    }
+  }
+};
+
+/**
+ * Hardware and software counters wrapped around a measurement:
+ * cycles, instructions and cache misses (one hardware group) as well as
+ * task clock, context switches and page faults (one software group).
+ *
+ * Tries to include the kernel first, as that is where sensor accesses spend
+ * most of their time. Falls back to user space only if that is forbidden.
+ */
+class PerfCounters {
+ private:
+  bool kernel_included_ = true;
+  std::unique_ptr<PerfEventGroup> hardware_;
+  std::unique_ptr<PerfEventGroup> software_;
+
+  /// opens all events, @returns true if at least one event is available
+  static bool open(PerfEventGroup& hardware, PerfEventGroup& software) {
+    if (hardware.add("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES)) {
+      hardware.add("instructions", PERF_TYPE_HARDWARE,
+                   PERF_COUNT_HW_INSTRUCTIONS);
+      hardware.add("cache_misses", PERF_TYPE_HARDWARE,
+                   PERF_COUNT_HW_CACHE_MISSES);
+    }
+
+    if (software.add("task_clock_ns", PERF_TYPE_SOFTWARE,
+                     PERF_COUNT_SW_TASK_CLOCK)) {
+      software.add("context_switches", PERF_TYPE_SOFTWARE,
+                   PERF_COUNT_SW_CONTEXT_SWITCHES);
+      software.add("page_faults", PERF_TYPE_SOFTWARE,
+                   PERF_COUNT_SW_PAGE_FAULTS);
+    }
+
+    return hardware.available() || software.available();
+  }
+
+ public:
+  PerfCounters() {
+    for (bool exclude_kernel : {false, true}) {
+      hardware_ = std::make_unique<PerfEventGroup>(exclude_kernel);
+      software_ = std::make_unique<PerfEventGroup>(exclude_kernel);
+      kernel_included_ = !exclude_kernel;
+
+      if (open(*hardware_, *software_)) {
+        return;
+      }
+      // most likely perf_event_paranoid >= 2: retry without kernel
+    }
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  /// false if perf_event_open is not usable at all (e.g. in a container)
+  bool available() const {
+    return hardware_->available() || software_->available();
+  }
+
+  /// true if kernel time is counted, false if user space only
+  bool kernelIncluded() const { return kernel_included_; }
+
+  void enable() {
+    hardware_->enable();
+    software_->enable();
+  }
+
+  void disable() {
+    software_->disable();
+    hardware_->disable();
+  }
+
+  /// continues counting after disable(), keeping the counts so far
+  void resume() {
+    hardware_->resume();
+    software_->resume();
+  }
+
+  /// @returns all available counter values by name
+  std::map<std::string, double> read() const {
+    auto result = hardware_->read();
+    result.merge(software_->read());
+    return result;
+  }
+};
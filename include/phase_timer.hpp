@@ -0,0 +1,115 @@
+#pragma once
+
+#include <sys/resource.h>
+#include <time.h>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * resources used by one phase of a record run
+ */
+struct PhaseTiming {
+  std::string name;
+  /// elapsed wall clock time in seconds
+  double wall_s = 0;
+  /// cpu time (user + system) in seconds, of the whole process or of the
+  /// thread which ran the phase, see PhaseClock
+  double cpu_s = 0;
+  /// peak resident set size of the process at the end of the phase, in KiB
+  long peak_rss_kib = 0;
+};
+
+/**
+ * whose cpu time a PhaseTimer measures
+ */
+enum class PhaseClock {
+  /// all threads of the process
+  process,
+  /// the thread calling start() and stop(), so other threads of the process
+  /// (e.g. --load or the system counter sampler) are not counted
+  thread,
+};
+
+/**
+ * Measures consecutive phases: starting a phase ends the previous one.
+ *
+ * Peak RSS is the high-water mark of the whole process (getrusage()), so it
+ * only ever grows: the phase which raises it is the one that allocated.
+ */
+class PhaseTimer {
+ private:
+  struct Running {
+    std::string name;
+    std::chrono::steady_clock::time_point wall_start;
+    double cpu_start;
+  };
+
+  clockid_t cpu_clock_;
+  std::optional<Running> running_;
+  std::vector<PhaseTiming> phases_;
+
+  double cpuSeconds() const {
+    timespec ts;
+    clock_gettime(cpu_clock_, &ts);
+    return double(ts.tv_sec) + double(ts.tv_nsec) / 1e9;
+  }
+
+  static long peakRssKib() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+  }
+
+ public:
+  /// @param clock with PhaseClock::thread, start() and stop() of a phase must
+  /// be called by the same thread
+  explicit PhaseTimer(PhaseClock clock = PhaseClock::process)
+      : cpu_clock_(PhaseClock::thread == clock ? CLOCK_THREAD_CPUTIME_ID
+                                               : CLOCK_PROCESS_CPUTIME_ID) {}
+
+  /// ends the running phase (if any) and starts a new one
+  void start(const std::string& name) {
+    stop();
+    running_ = Running{name, std::chrono::steady_clock::now(), cpuSeconds()};
+  }
+
+  /// ends the running phase (if any)
+  void stop() {
+    if (!running_) {
+      return;
+    }
+
+    std::chrono::duration<double> wall =
+        std::chrono::steady_clock::now() - running_->wall_start;
+    phases_.push_back({
+        .name = running_->name,
+        .wall_s = wall.count(),
+        .cpu_s = cpuSeconds() - running_->cpu_start,
+        .peak_rss_kib = peakRssKib(),
+    });
+    running_.reset();
+  }
+
+  const std::vector<PhaseTiming>& phases() const { return phases_; }
+
+  /// prints all finished phases as table
+  void print(std::ostream& out, const std::string& indent) const {
+    auto precision = out.precision();
+    out << indent << std::left << std::setw(18) << "phase" << std::right
+        << std::setw(14) << "wall [ms]" << std::setw(14) << "cpu [ms]"
+        << std::setw(18) << "peak rss [MiB]" << "\n";
+
+    for (const auto& phase : phases_) {
+      out << indent << std::left << std::setw(18) << phase.name << std::right
+          << std::fixed << std::setprecision(3) << std::setw(14)
+          << phase.wall_s * 1000 << std::setw(14) << phase.cpu_s * 1000
+          << std::setw(18) << phase.peak_rss_kib / 1024.0 << "\n";
+    }
+    out << std::defaultfloat << std::setprecision(precision);
+  }
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <dlfcn.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <regex>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <hwmondump_plugin.h>
+#include <reader_options.hpp>
+#include <timestamp_util.hpp>
+
+// samples of hwmondump are handed to plugins without copying
+static_assert(std::is_standard_layout_v<std::pair<uint64_t, double>>);
+static_assert(sizeof(std::pair<uint64_t, double>) == sizeof(hwmondump_sample));
+static_assert(offsetof(hwmondump_sample, timestamp_ns) == 0);
+static_assert(offsetof(hwmondump_sample, value) ==
+              sizeof(std::pair<uint64_t, double>) - sizeof(double));
+
+/**
+ * A loaded plugin shared object, see hwmondump_plugin.h. Stays loaded until
+ * destruction.
+ */
+class PluginLibrary {
+ private:
+  std::filesystem::path path_;
+  void* handle_;
+  const hwmondump_plugin* plugin_ = nullptr;
+
+ public:
+  /**
+   * loads the shared object and checks its plugin description
+   * @throws std::runtime_error if it can not be loaded or is no valid plugin
+   */
+  PluginLibrary(const std::filesystem::path& path)
+      : path_(path), handle_(dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL)) {
+    if (nullptr == handle_) {
+      throw std::runtime_error("could not load plugin " + path.string() +
+                               ": " + dlerror());
+    }
+
+    using entry_fn = const hwmondump_plugin* (*)();
+    auto entry =
+        reinterpret_cast<entry_fn>(dlsym(handle_, HWMONDUMP_PLUGIN_ENTRY));
+    std::string error;
+    if (nullptr == entry) {
+      error = "no symbol " HWMONDUMP_PLUGIN_ENTRY;
+    } else if (plugin_ = entry(); nullptr == plugin_) {
+      error = "no plugin description";
+    } else if (HWMONDUMP_PLUGIN_ABI_VERSION != plugin_->abi_version) {
+      error = "ABI version " + std::to_string(plugin_->abi_version) +
+              ", expected " + std::to_string(HWMONDUMP_PLUGIN_ABI_VERSION);
+    } else if (nullptr == plugin_->open || nullptr == plugin_->read_batch ||
+               nullptr == plugin_->close) {
+      error = "missing function";
+    } else if (nullptr == plugin_->name || !isValidName(plugin_->name)) {
+      error = "invalid method name";
+    }
+    if (!error.empty()) {
+      dlclose(handle_);
+      throw std::runtime_error("invalid plugin " + path.string() + ": " +
+                               error);
+    }
+  }
+
+  PluginLibrary(const PluginLibrary&) = delete;
+  PluginLibrary& operator=(const PluginLibrary&) = delete;
+
+  /**
+   * @returns true if name can be used as method name of a plugin: lowercase
+   * letters, digits and dashes (the part of the output files before the first
+   * underscore is the method), not used by a built-in method
+   */
+  static bool isValidName(const std::string& name) {
+    static const std::regex name_regex("^[a-z0-9-]+$");
+    for (const auto& builtin :
+         {"sysfs", "lseek", "libsensors", "null", "replay", "poll"}) {
+      if (name == builtin) {
+        return false;
+      }
+    }
+    return std::regex_match(name, name_regex);
+  }
+
+  const hwmondump_plugin& plugin() const { return *plugin_; }
+  const std::filesystem::path& path() const { return path_; }
+
+  ~PluginLibrary() { dlclose(handle_); }
+};
+
+/**
+ * @returns directories searched for plugins: those of HWMONDUMP_PLUGIN_PATH
+ * (colon separated), then the install directory
+ */
+static std::vector<std::filesystem::path> pluginSearchPath() {
+  std::vector<std::filesystem::path> dirs;
+  if (const char* env = std::getenv("HWMONDUMP_PLUGIN_PATH")) {
+    std::stringstream stream(env);
+    for (std::string dir; std::getline(stream, dir, ':');) {
+      if (!dir.empty()) {
+        dirs.push_back(dir);
+      }
+    }
+  }
+#ifdef HWMONDUMP_PLUGIN_DIR
+  dirs.push_back(HWMONDUMP_PLUGIN_DIR);
+#endif
+  return dirs;
+}
+
+/**
+ * @returns the plugin of method name: an already loaded one, or the first
+ * hwmondump_NAME.so of the search path, which is loaded and kept in loaded
+ * @throws std::runtime_error if there is no such plugin
+ */
+static const PluginLibrary& findPlugin(
+    const std::string& name,
+    std::list<PluginLibrary>& loaded,
+    const std::vector<std::filesystem::path>& search_path) {
+  for (const auto& library : loaded) {
+    if (name == library.plugin().name) {
+      return library;
+    }
+  }
+
+  for (const auto& dir : search_path) {
+    const auto candidate = dir / ("hwmondump_" + name + ".so");
+    if (!std::filesystem::exists(candidate)) {
+      continue;
+    }
+    const auto& library = loaded.emplace_back(candidate);
+    if (name != library.plugin().name) {
+      throw std::runtime_error("plugin " + candidate.string() +
+                               " provides method " + library.plugin().name +
+                               ", not " + name);
+    }
+    return library;
+  }
+
+  throw std::runtime_error("no plugin for method " + name +
+                           " (load one with --plugin or set "
+                           "HWMONDUMP_PLUGIN_PATH)");
+}
+
+/**
+ * Reader class with method:
+ * whatever the plugin of its ReaderOptions does, see hwmondump_plugin.h
+ *
+ * The method name is only known at runtime, so it is taken from the options
+ * too, see readerMethod().
+ */
+class ReaderPlugin {
+ private:
+  const hwmondump_plugin* plugin_;
+  void* state_ = nullptr;
+
+  static uint64_t timestamp() { return gettimestampnano(); }
+
+  void check(int result, const char* error) const {
+    if (0 != result) {
+      throw std::runtime_error(std::string("[") + plugin_->name +
+                               "] could not read sensor: " +
+                               (error ? error : "unknown error"));
+    }
+  }
+
+ public:
+  /**
+   * opens the sensor with options.plugin
+   * @throws std::runtime_error if no plugin is given or open() failed
+   */
+  ReaderPlugin(const std::filesystem::path& path, const ReaderOptions& options)
+      : plugin_(options.plugin) {
+    if (nullptr == plugin_) {
+      throw std::runtime_error("[plugin] no plugin given");
+    }
+    const char* error = nullptr;
+    state_ = plugin_->open(path.c_str(), &error);
+    if (nullptr == state_) {
+      throw std::runtime_error(std::string("[") + plugin_->name +
+                               "] could not open sensor: " +
+                               (error ? error : "unknown error"));
+    }
+  }
+
+  ReaderPlugin(const ReaderPlugin&) = delete;
+  ReaderPlugin& operator=(const ReaderPlugin&) = delete;
+
+  /**
+   * returns string of method name, if the plugin is not known
+   */
+  static const char* methodname() { return "plugin"; }
+
+  /**
+   * returns name of the plugin of options
+   */
+  static const char* methodname(const ReaderOptions& options) {
+    return options.plugin ? options.plugin->name : methodname();
+  }
+
+  /**
+   * takes a single sample with the plugin
+   * @returns value of the sample
+   * @throws std::runtime_error if the plugin reports an error
+   */
+  double getvalue() {
+    hwmondump_sample sample;
+    const char* error = nullptr;
+    check(plugin_->read_batch(state_, &sample, 1, &timestamp, &error), error);
+    return sample.value;
+  }
+
+  /**
+   * lets the plugin take all samples in one call, see BatchReader
+   * @throws std::runtime_error if the plugin reports an error
+   */
+  void getbatch(std::span<std::pair<uint64_t, double>> samples) {
+    const char* error = nullptr;
+    check(plugin_->read_batch(
+              state_, reinterpret_cast<hwmondump_sample*>(samples.data()),
+              samples.size(), &timestamp, &error),
+          error);
+  }
+
+  ~ReaderPlugin() { plugin_->close(state_); }
+};
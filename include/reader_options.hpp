@@ -0,0 +1,52 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <type_traits>
+
+#include <hwmondump_plugin.h>
+
+class ShmRingWriter;
+
+/**
+ * Settings of the readers of one run, handed to every reader constructed for
+ * it, so several runs (or users of libhwmondump) in one process do not share
+ * them. Readers without settings ignore them.
+ */
+struct ReaderOptions {
+  /// plugin providing the method of ReaderPlugin
+  const hwmondump_plugin* plugin = nullptr;
+  /// ReaderReplay follows the recorded timing, see ReaderReplay::getvalue()
+  bool replay_timing = false;
+  /// fallback polling interval of ReaderPoll for attributes without
+  /// notifications
+  int poll_timeout_ms = 100;
+  /// ring ReaderShm publishes to, nullptr = don't publish
+  ShmRingWriter* shm_ring = nullptr;
+};
+
+/**
+ * @returns R reading path, constructed with options if R takes them
+ */
+template <typename R>
+R makeReader(const std::filesystem::path& path, const ReaderOptions& options) {
+  if constexpr (std::is_constructible_v<R, const std::filesystem::path&,
+                                        const ReaderOptions&>) {
+    return R(path, options);
+  } else {
+    return R(path);
+  }
+}
+
+/**
+ * @returns method name of R, which depends on options for readers like
+ * ReaderPlugin
+ */
+template <typename R>
+std::string readerMethod(const ReaderOptions& options) {
+  if constexpr (requires { R::methodname(options); }) {
+    return R::methodname(options);
+  } else {
+    return R::methodname();
+  }
+}
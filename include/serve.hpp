@@ -0,0 +1,814 @@
+#pragma once
+
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <group_reader.hpp>
+#include <hwmondump_util.hpp>
+#include <survey.hpp>
+#include <sysfs_scan.hpp>
+
+/**
+ * a sensor kept up to date by hwmondump serve
+ */
+struct ServedSensor {
+  std::filesystem::path path;
+  /// reads per second
+  int rate_hz;
+  /// name of the method read() uses
+  std::string method;
+  /// takes one reading, may throw
+  std::function<double()> read;
+};
+
+/**
+ * @param spec sensor path, optionally followed by @HZ (e.g.
+ * /sys/class/hwmon/hwmon0/temp1_input@2)
+ * @param default_rate_hz rate if spec has none
+ * @returns sensor without reader, see attachServeReader()
+ * @throws std::runtime_error if the rate is invalid
+ */
+static ServedSensor parseServedSensor(const std::string& spec,
+                                      int default_rate_hz) {
+  ServedSensor sensor{
+      .path = spec, .rate_hz = default_rate_hz, .method = {}, .read = {}};
+  if (const auto at = spec.rfind('@'); at != std::string::npos) {
+    sensor.path = spec.substr(0, at);
+    try {
+      size_t parsed = 0;
+      sensor.rate_hz = std::stoi(spec.substr(at + 1), &parsed);
+      if (parsed != spec.size() - at - 1) {
+        throw std::invalid_argument(spec);
+      }
+    } catch (const std::logic_error&) {
+      throw std::runtime_error("invalid rate in " + spec + ", use PATH@HZ");
+    }
+  }
+  if (sensor.rate_hz <= 0 || sensor.rate_hz > 100000) {
+    throw std::runtime_error("rate of " + spec +
+                             " must be between 1 Hz and 100 kHz");
+  }
+  return sensor;
+}
+
+/**
+ * lets sensor read with a reader of its own of method R
+ * @throws std::runtime_error if the reader can not be constructed
+ */
+template <Reader R>
+void attachServeReader(ServedSensor& sensor) {
+  auto reader = std::make_shared<R>(sensor.path);
+  sensor.method = R::methodname();
+  sensor.read = [reader] { return reader->getvalue(); };
+}
+
+/**
+ * lets sensor read with the cheaper of sysfs and lseek, determined by
+ * reading it with both for probe (see surveySensor())
+ * @throws std::runtime_error if the sensor can not be read with either
+ */
+static void attachCheapestServeReader(ServedSensor& sensor,
+                                      std::chrono::milliseconds probe) {
+  const auto sysfs = surveySensor<ReaderSysfs>(sensor.path, probe);
+  const auto lseek = surveySensor<ReaderLseek>(sensor.path, probe);
+  if (!sysfs.error.empty() && !lseek.error.empty()) {
+    throw std::runtime_error("could not read " + sensor.path.string() + ": " +
+                             lseek.error);
+  }
+  if (lseek.error.empty() &&
+      (!sysfs.error.empty() || lseek.cost.median_ns <= sysfs.cost.median_ns)) {
+    attachServeReader<ReaderLseek>(sensor);
+  } else {
+    attachServeReader<ReaderSysfs>(sensor);
+  }
+}
+
+/**
+ * latest reading of a served sensor
+ */
+struct CachedReading {
+  double value = 0;
+  /// taken right before the access, 0 if the sensor was never read
+  uint64_t timestamp = 0;
+  uint64_t reads = 0;
+  uint64_t errors = 0;
+  /// message of the last failed read
+  std::string error;
+};
+
+/**
+ * Reads every sensor at its own rate and caches the latest value.
+ *
+ * Sensors are polled by one thread per bus (see surveyBusKey()), so a slow
+ * chip only delays the sensors sharing its bus, which the driver would
+ * serialize anyway. Deadlines are absolute; if a read takes longer than the
+ * period, the missed deadlines are skipped instead of read in a burst.
+ */
+class SensorPoller {
+ private:
+  std::vector<ServedSensor> sensors_;
+  std::vector<CachedReading> cache_;
+  mutable std::mutex cache_mutex_;
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable stop_cv_;
+  bool stop_requested_ = false;
+
+  void poll(size_t i) {
+    const uint64_t timestamp = gettimestampnano();
+    try {
+      const double value = sensors_[i].read();
+      std::lock_guard lock(cache_mutex_);
+      cache_[i].value = value;
+      cache_[i].timestamp = timestamp;
+      ++cache_[i].reads;
+    } catch (const std::exception& e) {
+      std::lock_guard lock(cache_mutex_);
+      ++cache_[i].errors;
+      cache_[i].error = e.what();
+    }
+  }
+
+  void pollLoop(std::vector<size_t> indices) {
+    using clock = std::chrono::steady_clock;
+    std::vector<clock::time_point> deadlines(indices.size(), clock::now());
+    std::vector<clock::duration> periods;
+    for (size_t i : indices) {
+      periods.push_back(std::chrono::nanoseconds(1000000000 /
+                                                 sensors_[i].rate_hz));
+    }
+    for (size_t k = 0; k < indices.size(); ++k) {
+      deadlines[k] += periods[k];
+    }
+
+    std::unique_lock lock(mutex_);
+    while (true) {
+      const size_t next =
+          std::min_element(deadlines.begin(), deadlines.end()) -
+          deadlines.begin();
+      if (stop_cv_.wait_until(lock, deadlines[next],
+                              [this] { return stop_requested_; })) {
+        return;
+      }
+
+      // other buses must not wait for this read
+      lock.unlock();
+      poll(indices[next]);
+      lock.lock();
+
+      deadlines[next] += periods[next];
+      const auto now = clock::now();
+      if (deadlines[next] < now) {
+        deadlines[next] = now + periods[next];
+      }
+    }
+  }
+
+ public:
+  /**
+   * reads every sensor once, so all have a value (or an error) before
+   * start() is called
+   */
+  SensorPoller(std::vector<ServedSensor> sensors)
+      : sensors_(std::move(sensors)), cache_(sensors_.size()) {
+    for (size_t i = 0; i < sensors_.size(); ++i) {
+      poll(i);
+    }
+  }
+
+  SensorPoller(const SensorPoller&) = delete;
+  SensorPoller& operator=(const SensorPoller&) = delete;
+
+  /// starts polling in the background
+  void start() {
+    std::map<std::string, std::vector<size_t>> buses;
+    for (size_t i = 0; i < sensors_.size(); ++i) {
+      buses[surveyBusKey(sensors_[i].path.parent_path())].push_back(i);
+    }
+
+    stop_requested_ = false;
+    for (auto& [bus, indices] : buses) {
+      threads_.emplace_back(&SensorPoller::pollLoop, this, indices);
+    }
+  }
+
+  /// stops polling, the cache keeps the last values
+  void stop() {
+    {
+      std::lock_guard lock(mutex_);
+      stop_requested_ = true;
+    }
+    stop_cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+  }
+
+  const std::vector<ServedSensor>& sensors() const { return sensors_; }
+
+  /// @returns index of the sensor with that path
+  std::optional<size_t> find(const std::string& path) const {
+    for (size_t i = 0; i < sensors_.size(); ++i) {
+      if (sensors_[i].path == path) {
+        return i;
+      }
+    }
+    return std::nullopt;
+  }
+
+  /// @returns copy of the latest reading of sensor i
+  CachedReading reading(size_t i) const {
+    std::lock_guard lock(cache_mutex_);
+    return cache_.at(i);
+  }
+
+  ~SensorPoller() { stop(); }
+};
+
+/**
+ * @returns line describing the latest reading of sensor i: path, value,
+ * timestamp and age in ns, or ERR if it was never read successfully
+ */
+static std::string serveReadingLine(const SensorPoller& poller, size_t i) {
+  const auto reading = poller.reading(i);
+  const auto& path = poller.sensors()[i].path.string();
+  std::stringstream line;
+  if (0 == reading.timestamp) {
+    line << "ERR " << path << " " << reading.error << "\n";
+  } else {
+    const uint64_t now = gettimestampnano();
+    line << std::fixed << path << " " << reading.value << " "
+         << reading.timestamp << " "
+         << (now > reading.timestamp ? now - reading.timestamp : 0) << "\n";
+  }
+  return line.str();
+}
+
+/**
+ * answers one request line of the serve protocol:
+ *  - GET PATH: latest reading of one sensor
+ *  - ALL: latest reading of every sensor, followed by an empty line
+ *  - LIST: path, method, rate, reads and errors of every sensor, followed by
+ *    an empty line
+ * @returns response, ERR and a message for invalid requests
+ */
+static std::string serveResponse(const SensorPoller& poller,
+                                 const std::string& request) {
+  if (request.starts_with("GET ")) {
+    const auto i = poller.find(request.substr(4));
+    if (!i) {
+      return "ERR " + request.substr(4) + " is not served\n";
+    }
+    return serveReadingLine(poller, *i);
+  }
+
+  std::string response;
+  if ("ALL" == request) {
+    for (size_t i = 0; i < poller.sensors().size(); ++i) {
+      response += serveReadingLine(poller, i);
+    }
+  } else if ("LIST" == request) {
+    for (size_t i = 0; i < poller.sensors().size(); ++i) {
+      const auto& sensor = poller.sensors()[i];
+      const auto reading = poller.reading(i);
+      response += sensor.path.string() + " " + sensor.method + " " +
+                  std::to_string(sensor.rate_hz) + " " +
+                  std::to_string(reading.reads) + " " +
+                  std::to_string(reading.errors) + "\n";
+    }
+  } else {
+    return "ERR unknown request, use GET PATH, ALL or LIST\n";
+  }
+  return response + "\n";
+}
+
+/**
+ * Answers requests of any number of clients on a Unix domain socket from the
+ * cache of a SensorPoller, in a single thread driven by epoll. Clients never
+ * touch a sensor, so their number does not change the load on the sensors.
+ *
+ * Requests are lines (see serveResponse()) and may be pipelined. A client
+ * closing its sending side gets the remaining responses before the
+ * connection is closed.
+ */
+class ServeDaemon {
+ private:
+  struct Client {
+    std::string in;
+    std::string out;
+    /// events the client is registered for
+    uint32_t events = EPOLLIN;
+    bool closing = false;
+  };
+
+  /// longest request line accepted
+  static constexpr size_t max_request = 4096;
+  /// responses buffered for a client not reading them
+  static constexpr size_t max_pending = 1 << 20;
+
+  const SensorPoller& poller_;
+  std::filesystem::path socket_path_;
+  size_t max_clients_;
+  int listen_fd_ = -1;
+  int epoll_fd_ = -1;
+  int stop_fd_ = -1;
+  /// the socket file was created by this daemon
+  bool bound_ = false;
+  std::map<int, Client> clients_;
+  uint64_t connections_ = 0;
+  uint64_t requests_ = 0;
+
+  void watch(int fd, uint32_t events, int op) {
+    epoll_event event{.events = events, .data = {.fd = fd}};
+    if (0 != epoll_ctl(epoll_fd_, op, fd, &event)) {
+      throw std::runtime_error(std::string("epoll_ctl failed: ") +
+                               strerror(errno));
+    }
+  }
+
+  /// closes all fds and removes the socket file, if it was created
+  void release() {
+    for (const auto& [fd, client] : clients_) {
+      close(fd);
+    }
+    clients_.clear();
+    for (int fd : {stop_fd_, epoll_fd_, listen_fd_}) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+    if (bound_) {
+      std::filesystem::remove(socket_path_);
+    }
+  }
+
+  void drop(int fd) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients_.erase(fd);
+  }
+
+  void accept() {
+    while (true) {
+      int fd = accept4(listen_fd_, nullptr, nullptr,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) {
+        return;
+      }
+      if (clients_.size() >= max_clients_) {
+        close(fd);
+        continue;
+      }
+      ++connections_;
+      clients_[fd] = {};
+      watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+    }
+  }
+
+  /// @returns false if the client was dropped
+  bool flush(int fd, Client& client) {
+    while (!client.out.empty()) {
+      const ssize_t written =
+          send(fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+      if (written < 0) {
+        if (EAGAIN == errno || EWOULDBLOCK == errno) {
+          break;
+        }
+        drop(fd);
+        return false;
+      }
+      client.out.erase(0, written);
+    }
+
+    if (client.out.empty() && client.closing) {
+      drop(fd);
+      return false;
+    }
+    // only wait for writability while something is pending, and no longer
+    // for requests once the client closed its sending side: its socket stays
+    // readable at end of file, so EPOLLIN would wake run() over and over
+    uint32_t events = client.closing ? 0 : uint32_t(EPOLLIN);
+    if (!client.out.empty()) {
+      events |= EPOLLOUT;
+    }
+    if (events != client.events) {
+      client.events = events;
+      watch(fd, events, EPOLL_CTL_MOD);
+    }
+    return true;
+  }
+
+  void receive(int fd, Client& client) {
+    char buf[4096];
+    while (true) {
+      const ssize_t received = recv(fd, buf, sizeof(buf), 0);
+      if (received > 0) {
+        client.in.append(buf, received);
+        continue;
+      }
+      if (0 == received) {
+        client.closing = true;
+      } else if (EAGAIN != errno && EWOULDBLOCK != errno) {
+        drop(fd);
+        return;
+      }
+      break;
+    }
+
+    size_t start = 0;
+    for (size_t end; (end = client.in.find('\n', start)) != std::string::npos;
+         start = end + 1) {
+      std::string request = client.in.substr(start, end - start);
+      if (request.ends_with('\r')) {
+        request.pop_back();
+      }
+      ++requests_;
+      client.out += serveResponse(poller_, request);
+    }
+    client.in.erase(0, start);
+
+    if (client.in.size() > max_request || client.out.size() > max_pending) {
+      drop(fd);
+      return;
+    }
+    flush(fd, client);
+  }
+
+ public:
+  /**
+   * listens on socket_path
+   * @param max_clients further connections are closed right away
+   * @throws std::runtime_error if the socket exists or can not be created
+   */
+  ServeDaemon(const SensorPoller& poller,
+              const std::filesystem::path& socket_path,
+              size_t max_clients)
+      : poller_(poller), socket_path_(socket_path), max_clients_(max_clients) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.string().size() >= sizeof(address.sun_path)) {
+      throw std::runtime_error("socket path too long: " + socket_path.string());
+    }
+    strcpy(address.sun_path, socket_path.c_str());
+    if (std::filesystem::exists(std::filesystem::symlink_status(socket_path))) {
+      throw std::runtime_error(socket_path.string() +
+                               " exists, remove it if no daemon uses it");
+    }
+
+    // the destructor does not run if the constructor throws
+    try {
+      listen_fd_ =
+          socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      bound_ = listen_fd_ >= 0 &&
+               0 == bind(listen_fd_, reinterpret_cast<sockaddr*>(&address),
+                         sizeof(address));
+      if (!bound_ || 0 != listen(listen_fd_, SOMAXCONN)) {
+        throw std::runtime_error("could not listen on " +
+                                 socket_path.string() + ": " +
+                                 strerror(errno));
+      }
+
+      epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+      if (epoll_fd_ < 0) {
+        throw std::runtime_error(std::string("epoll_create1 failed: ") +
+                                 strerror(errno));
+      }
+      stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (stop_fd_ < 0) {
+        throw std::runtime_error(std::string("eventfd failed: ") +
+                                 strerror(errno));
+      }
+      watch(listen_fd_, EPOLLIN, EPOLL_CTL_ADD);
+      watch(stop_fd_, EPOLLIN, EPOLL_CTL_ADD);
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+
+  ServeDaemon(const ServeDaemon&) = delete;
+  ServeDaemon& operator=(const ServeDaemon&) = delete;
+
+  /// answers requests until stop() is called
+  void run() {
+    std::vector<epoll_event> events(64);
+    while (true) {
+      const int ready = epoll_wait(epoll_fd_, events.data(), events.size(), -1);
+      if (ready < 0 && EINTR == errno) {
+        continue;
+      }
+      if (ready < 0) {
+        throw std::runtime_error(std::string("epoll_wait failed: ") +
+                                 strerror(errno));
+      }
+
+      for (int e = 0; e < ready; ++e) {
+        const int fd = events[e].data.fd;
+        if (fd == stop_fd_) {
+          return;
+        }
+        if (fd == listen_fd_) {
+          accept();
+          continue;
+        }
+        auto client = clients_.find(fd);
+        if (client == clients_.end()) {
+          continue;
+        }
+        if (events[e].events & (EPOLLERR | EPOLLHUP) &&
+            !(events[e].events & EPOLLIN)) {
+          drop(fd);
+        } else if (events[e].events & EPOLLIN) {
+          receive(fd, client->second);
+        } else if (events[e].events & EPOLLOUT) {
+          flush(fd, client->second);
+        }
+      }
+    }
+  }
+
+  /// lets run() return, may be called from any thread
+  void stop() {
+    const uint64_t one = 1;
+    [[maybe_unused]] auto written = write(stop_fd_, &one, sizeof(one));
+  }
+
+  /// number of clients connected so far
+  uint64_t connections() const { return connections_; }
+
+  /// number of requests answered so far
+  uint64_t requests() const { return requests_; }
+
+  ~ServeDaemon() { release(); }
+};
+
+/**
+ * sends request to the daemon listening on socket_path and closes the
+ * sending side
+ * @returns everything the daemon answered
+ * @throws std::runtime_error if the daemon can not be reached
+ */
+static std::string serveQuery(const std::filesystem::path& socket_path,
+                              const std::string& request) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (socket_path.string().size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error("socket path too long: " + socket_path.string());
+  }
+  strcpy(address.sun_path, socket_path.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || 0 != connect(fd, reinterpret_cast<sockaddr*>(&address),
+                             sizeof(address))) {
+    const std::string error = strerror(errno);
+    if (fd >= 0) {
+      close(fd);
+    }
+    throw std::runtime_error("could not connect to " + socket_path.string() +
+                             ": " + error);
+  }
+
+  for (size_t sent = 0; sent < request.size();) {
+    const ssize_t written = send(fd, request.data() + sent,
+                                 request.size() - sent, MSG_NOSIGNAL);
+    if (written < 0) {
+      close(fd);
+      throw std::runtime_error("could not send request");
+    }
+    sent += written;
+  }
+  shutdown(fd, SHUT_WR);
+
+  std::string response;
+  char buf[4096];
+  for (ssize_t received; (received = recv(fd, buf, sizeof(buf), 0)) != 0;) {
+    if (received < 0) {
+      if (EINTR == errno) {
+        continue;
+      }
+      close(fd);
+      throw std::runtime_error("could not receive response");
+    }
+    response.append(buf, received);
+  }
+  close(fd);
+  return response;
+}
+
+/**
+ * Blocks SIGINT and SIGTERM in the calling thread while it exists, so a
+ * subcommand can wait for them with sigwait() or sigtimedwait(). Threads
+ * started meanwhile inherit the mask, so the signals reach only the waiting
+ * thread. The previous mask is restored on every return.
+ */
+class TerminationSignals {
+ private:
+  sigset_t signals_;
+  sigset_t previous_;
+
+ public:
+  TerminationSignals() {
+    sigemptyset(&signals_);
+    sigaddset(&signals_, SIGINT);
+    sigaddset(&signals_, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals_, &previous_);
+  }
+
+  TerminationSignals(const TerminationSignals&) = delete;
+  TerminationSignals& operator=(const TerminationSignals&) = delete;
+
+  /// SIGINT and SIGTERM
+  const sigset_t& set() const { return signals_; }
+
+  ~TerminationSignals() { pthread_sigmask(SIG_SETMASK, &previous_, nullptr); }
+};
+
+/**
+ * polls the selected sensors in the background and answers clients on a
+ * Unix domain socket until SIGINT/SIGTERM or --duration
+ * @returns 0 on success
+ * @returns -1 on failure
+ */
+int serveSubcommand(argparse::ArgumentParser& serve_command) {
+  const int rate_hz = serve_command.get<int>("--rate");
+  const int probe_ms = serve_command.get<int>("--probe-ms");
+  const int max_clients = serve_command.get<int>("--max-clients");
+  const auto method = serve_command.get<std::string>("--method");
+  int duration = 0;
+  if (serve_command.is_used("--duration")) {
+    duration = serve_command.get<int>("--duration");
+  }
+  if (probe_ms <= 0) {
+    std::cerr << "probe time must be at least 1 ms\n";
+    return -1;
+  }
+  if (max_clients <= 0) {
+    std::cerr << "allow at least one client\n";
+    return -1;
+  }
+  if ("auto" != method && "sysfs" != method && "lseek" != method) {
+    std::cerr << "unknown method " << method << ", use auto, sysfs or lseek\n";
+    return -1;
+  }
+
+  // before any thread is started
+  const TerminationSignals signals;
+
+  try {
+    std::vector<ServedSensor> sensors;
+    if (serve_command.is_used("--sensor")) {
+      for (const auto& spec :
+           serve_command.get<std::vector<std::string>>("--sensor")) {
+        sensors.push_back(parseServedSensor(spec, rate_hz));
+      }
+    }
+    if (serve_command.is_used("--attributes")) {
+      const auto globs =
+          parseGlobList(serve_command.get<std::string>("--attributes"));
+      for (const auto& attribute :
+           scanHwmonTree(serve_command.get<std::string>("--hwmon-root"))) {
+        const std::filesystem::path path = attribute.full_path();
+        const bool matches =
+            std::any_of(globs.begin(), globs.end(), [&](const auto& glob) {
+              return 0 == fnmatch(glob.c_str(),
+                                  attribute.subfeature_name.c_str(), 0);
+            });
+        // sensors given with --sensor keep their own rate
+        const bool given =
+            std::any_of(sensors.begin(), sensors.end(),
+                        [&](const auto& sensor) { return sensor.path == path; });
+        if (matches && !given) {
+          sensors.push_back(parseServedSensor(path, rate_hz));
+        }
+      }
+    }
+    if (sensors.empty()) {
+      std::cerr << "no sensor to serve, use --sensor or --attributes\n";
+      return -1;
+    }
+
+    for (auto& sensor : sensors) {
+      if ("sysfs" == method) {
+        attachServeReader<ReaderSysfs>(sensor);
+      } else if ("lseek" == method) {
+        attachServeReader<ReaderLseek>(sensor);
+      } else {
+        attachCheapestServeReader(sensor, std::chrono::milliseconds(probe_ms));
+      }
+      std::cout << sensor.path.string() << " " << sensor.method << " "
+                << sensor.rate_hz << "\n";
+    }
+    std::cout << std::flush;
+
+    SensorPoller poller(std::move(sensors));
+    ServeDaemon daemon(poller, serve_command.get<std::string>("SOCKET"),
+                       max_clients);
+    poller.start();
+    std::exception_ptr error;
+    std::thread server([&] {
+      try {
+        daemon.run();
+      } catch (...) {
+        error = std::current_exception();
+      }
+    });
+    std::cerr << "serving " << poller.sensors().size() << " sensor(s) on "
+              << serve_command.get<std::string>("SOCKET")
+              << ", stop with Ctrl-C\n";
+
+    if (duration > 0) {
+      timespec timeout = {.tv_sec = duration, .tv_nsec = 0};
+      sigtimedwait(&signals.set(), nullptr, &timeout);
+    } else {
+      int signal;
+      sigwait(&signals.set(), &signal);
+    }
+
+    daemon.stop();
+    server.join();
+    poller.stop();
+    if (error) {
+      std::rethrow_exception(error);
+    }
+
+    uint64_t reads = 0;
+    for (size_t i = 0; i < poller.sensors().size(); ++i) {
+      reads += poller.reading(i).reads;
+    }
+    std::cerr << "answered " << daemon.requests() << " request(s) of "
+              << daemon.connections() << " client(s) with " << reads
+              << " read(s)\n";
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * asks a running hwmondump serve for the latest readings and prints them
+ * @returns 0 if every requested sensor had a reading
+ * @returns -1 otherwise
+ */
+int querySubcommand(argparse::ArgumentParser& query_command) {
+  std::string request;
+  if (query_command.get<bool>("--list")) {
+    request = "LIST\n";
+  } else if (query_command.is_used("SENSOR")) {
+    for (const auto& sensor :
+         query_command.get<std::vector<std::string>>("SENSOR")) {
+      request += "GET " + sensor + "\n";
+    }
+  } else {
+    request = "ALL\n";
+  }
+
+  try {
+    std::stringstream response(
+        serveQuery(query_command.get<std::string>("SOCKET"), request));
+    bool failed = false;
+    for (std::string line; std::getline(response, line);) {
+      if (line.empty()) {
+        continue;
+      }
+      if (line.starts_with("ERR ")) {
+        std::cerr << line.substr(4) << "\n";
+        failed = true;
+      } else {
+        std::cout << line << "\n";
+      }
+    }
+    return failed ? -1 : 0;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return -1;
+  }
+}
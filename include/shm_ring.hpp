@@ -0,0 +1,446 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <reader_options.hpp>
+#include <timestamp_util.hpp>
+
+/// "HWMDRING" in little endian
+static constexpr uint64_t shm_ring_magic = 0x474e4952444d5748;
+static constexpr uint32_t shm_ring_version = 1;
+
+// shared between processes, so the atomics must not fall back to locks
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+/**
+ * One sample in the ring. A slot is a seqlock: sequence is 0 while the slot
+ * is written and n + 1 once it holds sample n.
+ */
+struct ShmRingSlot {
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> timestamp;
+  /// value as bits of a double
+  std::atomic<uint64_t> value;
+};
+
+/**
+ * Start of the shared memory object, followed by capacity slots.
+ */
+struct ShmRingHeader {
+  uint64_t magic;
+  uint32_t version;
+  /// number of slots, a power of two
+  uint32_t capacity;
+  /// recording method and sensor, set once the first reader is constructed
+  char method[32];
+  char sensor[224];
+  /// number of samples published so far
+  alignas(64) std::atomic<uint64_t> head;
+  /// set by the producer when it is done
+  std::atomic<uint32_t> closed;
+};
+
+/// @returns bytes of a ring with capacity slots
+static size_t shmRingSize(uint32_t capacity) {
+  return sizeof(ShmRingHeader) + sizeof(ShmRingSlot) * size_t(capacity);
+}
+
+/// @returns name as expected by shm_open(), i.e. with leading slash
+static std::string shmObjectName(const std::string& name) {
+  if (name.empty() || name.find('/', 1) != std::string::npos) {
+    throw std::runtime_error("invalid shared memory name: " + name);
+  }
+  return name.front() == '/' ? name : "/" + name;
+}
+
+/**
+ * Single producer of a POSIX shared memory ring of samples (shm_open(), so
+ * the ring is /dev/shm/NAME). Consumers attach with ShmRingReader at any time
+ * and get every sample still in the ring, the producer never waits for them.
+ *
+ * The ring is removed on destruction.
+ */
+class ShmRingWriter {
+ private:
+  std::string name_;
+  ShmRingHeader* header_ = nullptr;
+  ShmRingSlot* slots_ = nullptr;
+  uint64_t mask_;
+  uint64_t head_ = 0;
+
+ public:
+  /**
+   * creates the ring
+   * @param capacity number of samples kept, rounded up to a power of two
+   * @throws std::runtime_error if the ring exists or can not be created
+   */
+  ShmRingWriter(const std::string& name, uint32_t capacity)
+      : name_(shmObjectName(name)) {
+    if (capacity < 2 || capacity > (1u << 30)) {
+      throw std::runtime_error("ring capacity must be between 2 and 2^30");
+    }
+    capacity = std::bit_ceil(capacity);
+    mask_ = capacity - 1;
+
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && EEXIST == errno) {
+      throw std::runtime_error("shared memory " + name_ +
+                               " exists, remove /dev/shm" + name_ +
+                               " if no other recording uses it");
+    }
+    if (fd < 0) {
+      throw std::runtime_error("could not create shared memory " + name_ +
+                               ": " + strerror(errno));
+    }
+    const size_t size = shmRingSize(capacity);
+    void* memory = MAP_FAILED;
+    if (0 == ftruncate(fd, size)) {
+      memory =
+          mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (MAP_FAILED == memory) {
+      shm_unlink(name_.c_str());
+      throw std::runtime_error("could not map shared memory " + name_);
+    }
+
+    // ftruncate() zeroed everything, i.e. all slots are empty
+    header_ = new (memory) ShmRingHeader{
+        .magic = shm_ring_magic,
+        .version = shm_ring_version,
+        .capacity = capacity,
+        .method = {},
+        .sensor = {},
+        .head = 0,
+        .closed = 0,
+    };
+    slots_ = reinterpret_cast<ShmRingSlot*>(
+        static_cast<char*>(memory) + sizeof(ShmRingHeader));
+  }
+
+  ShmRingWriter(const ShmRingWriter&) = delete;
+  ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+  /// names the stream for consumers, truncated to fit
+  void setSource(const std::string& method, const std::string& sensor) {
+    strncpy(header_->method, method.c_str(), sizeof(header_->method) - 1);
+    strncpy(header_->sensor, sensor.c_str(), sizeof(header_->sensor) - 1);
+  }
+
+  /// publishes the next sample
+  void push(uint64_t timestamp, double value) {
+    ShmRingSlot& slot = slots_[head_ & mask_];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timestamp.store(timestamp, std::memory_order_relaxed);
+    slot.value.store(std::bit_cast<uint64_t>(value),
+                     std::memory_order_relaxed);
+    slot.sequence.store(head_ + 1, std::memory_order_release);
+    header_->head.store(++head_, std::memory_order_release);
+  }
+
+  /// @returns number of samples published
+  uint64_t published() const { return head_; }
+
+  uint32_t capacity() const { return header_->capacity; }
+
+  const std::string& name() const { return name_; }
+
+  /// tells consumers that no more samples follow
+  void finish() { header_->closed.store(1, std::memory_order_release); }
+
+  ~ShmRingWriter() {
+    finish();
+    munmap(header_, shmRingSize(header_->capacity));
+    shm_unlink(name_.c_str());
+  }
+};
+
+/**
+ * sample taken from a ring
+ */
+struct ShmRingSample {
+  /// number of the sample since the producer started, gaps are lost samples
+  uint64_t sequence;
+  uint64_t timestamp;
+  double value;
+};
+
+/**
+ * Consumer of a ring created by ShmRingWriter. Consumers only read the
+ * shared memory, so any number of them can follow one producer.
+ */
+class ShmRingReader {
+ private:
+  std::string name_;
+  const ShmRingHeader* header_ = nullptr;
+  const ShmRingSlot* slots_ = nullptr;
+  size_t size_ = 0;
+  uint64_t mask_;
+  uint64_t next_ = 0;
+  uint64_t lost_ = 0;
+
+  /// @returns false if sample n was overwritten
+  bool read(uint64_t n, ShmRingSample& sample) const {
+    const ShmRingSlot& slot = slots_[n & mask_];
+    const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != n + 1) {
+      return false;
+    }
+    sample.sequence = n;
+    sample.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+    sample.value =
+        std::bit_cast<double>(slot.value.load(std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == sequence;
+  }
+
+ public:
+  /**
+   * attaches to the ring
+   * @param from_oldest start with the oldest sample in the ring instead of
+   * the next one published
+   * @throws std::runtime_error if there is no valid ring of that name
+   */
+  ShmRingReader(const std::string& name, bool from_oldest = false)
+      : name_(shmObjectName(name)) {
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+      throw std::runtime_error("could not open shared memory " + name_ +
+                               ": " + strerror(errno));
+    }
+    struct stat info;
+    void* memory = MAP_FAILED;
+    if (0 == fstat(fd, &info) && size_t(info.st_size) >= sizeof(ShmRingHeader)) {
+      size_ = info.st_size;
+      memory = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (MAP_FAILED == memory) {
+      throw std::runtime_error("could not map shared memory " + name_);
+    }
+
+    header_ = static_cast<const ShmRingHeader*>(memory);
+    if (shm_ring_magic != header_->magic ||
+        shm_ring_version != header_->version ||
+        size_ < shmRingSize(header_->capacity)) {
+      munmap(memory, size_);
+      throw std::runtime_error(name_ + " is no hwmondump ring");
+    }
+    slots_ = reinterpret_cast<const ShmRingSlot*>(
+        static_cast<const char*>(memory) + sizeof(ShmRingHeader));
+    mask_ = header_->capacity - 1;
+
+    const uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (from_oldest) {
+      next_ = head > header_->capacity ? head - header_->capacity : 0;
+    } else {
+      next_ = head;
+    }
+  }
+
+  ShmRingReader(const ShmRingReader&) = delete;
+  ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+  /**
+   * appends the samples published since the last call to samples, at most
+   * max; samples overwritten before they could be read are counted as lost
+   * @returns number of samples appended
+   */
+  size_t poll(std::vector<ShmRingSample>& samples, size_t max = SIZE_MAX) {
+    const uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (head - next_ > header_->capacity) {
+      lost_ += head - header_->capacity - next_;
+      next_ = head - header_->capacity;
+    }
+
+    size_t taken = 0;
+    ShmRingSample sample;
+    for (; next_ < head && taken < max; ++next_) {
+      if (read(next_, sample)) {
+        samples.push_back(sample);
+        ++taken;
+      } else {
+        ++lost_;
+      }
+    }
+    return taken;
+  }
+
+  /// @returns number of samples overwritten before they were read
+  uint64_t lost() const { return lost_; }
+
+  /// @returns true once the producer finished, poll() until it returns 0
+  bool finished() const {
+    return 0 != header_->closed.load(std::memory_order_acquire);
+  }
+
+  std::string method() const {
+    return std::string(header_->method,
+                       strnlen(header_->method, sizeof(header_->method)));
+  }
+
+  std::string sensor() const {
+    return std::string(header_->sensor,
+                       strnlen(header_->sensor, sizeof(header_->sensor)));
+  }
+
+  uint32_t capacity() const { return header_->capacity; }
+
+  ~ShmRingReader() { munmap(const_cast<ShmRingHeader*>(header_), size_); }
+};
+
+/**
+ * Reader class with method:
+ * that of R, additionally publishing every sample to a ring
+ *
+ * Samples are published right after they are taken, so consumers see them
+ * while the recording is still running, warmup included.
+ */
+template <typename R>
+class ReaderShm {
+ private:
+  R reader_;
+  ShmRingWriter* ring_;
+
+ public:
+  /// samples a batch reader takes before they are published
+  static constexpr size_t batch_size = 64;
+
+  /**
+   * opens R with options, publishing to options.shm_ring
+   * @throws std::runtime_error if there is no ring or R can not be opened
+   */
+  ReaderShm(const std::filesystem::path& path, const ReaderOptions& options)
+      : reader_(makeReader<R>(path, options)), ring_(options.shm_ring) {
+    if (nullptr == ring_) {
+      throw std::runtime_error("[shm] no ring to publish to");
+    }
+    ring_->setSource(readerMethod<R>(options), path);
+  }
+
+  static auto methodname() { return R::methodname(); }
+
+  static std::string methodname(const ReaderOptions& options) {
+    return readerMethod<R>(options);
+  }
+
+  /// reads and publishes with a timestamp of its own
+  double getvalue() {
+    const uint64_t timestamp = gettimestampnano();
+    const double value = reader_.getvalue();
+    ring_->push(timestamp, value);
+    return value;
+  }
+
+  /**
+   * takes the samples like R would, batch readers in chunks of batch_size,
+   * publishing every chunk right after it was taken, see BatchReader
+   */
+  void getbatch(std::span<std::pair<uint64_t, double>> samples) {
+    if constexpr (requires { reader_.getbatch(samples); }) {
+      for (size_t start = 0; start < samples.size(); start += batch_size) {
+        const auto chunk = samples.subspan(
+            start, std::min(batch_size, samples.size() - start));
+        reader_.getbatch(chunk);
+        for (const auto& [timestamp, value] : chunk) {
+          ring_->push(timestamp, value);
+        }
+      }
+    } else {
+      for (auto& sample : samples) {
+        sample.first = gettimestampnano();
+        sample.second = reader_.getvalue();
+        ring_->push(sample.first, sample.second);
+      }
+    }
+  }
+
+  std::map<std::string, double> stats() const
+    requires requires(const R r) { r.stats(); }
+  {
+    return reader_.stats();
+  }
+};
+
+/**
+ * follows the ring of a running hwmondump record --shm and prints its
+ * samples as CSV until the recording finished or --count samples were printed
+ * @returns 0 on success
+ * @returns -1 on failure
+ */
+int subscribeSubcommand(argparse::ArgumentParser& subscribe_command) {
+  const int count = subscribe_command.is_used("--count")
+                        ? subscribe_command.get<int>("--count")
+                        : 0;
+  if (count < 0) {
+    std::cerr << "count must not be negative\n";
+    return -1;
+  }
+  const int interval_us = subscribe_command.get<int>("--interval-us");
+  if (interval_us <= 0) {
+    std::cerr << "poll interval must be at least 1 us\n";
+    return -1;
+  }
+
+  try {
+    ShmRingReader ring(subscribe_command.get<std::string>("NAME"),
+                       subscribe_command.get<bool>("--from-oldest"));
+    std::cerr << "following " << ring.method() << " of " << ring.sensor()
+              << "\n";
+
+    std::cout << "sequence,nanoseconds,value\n";
+    std::vector<ShmRingSample> samples;
+    uint64_t printed = 0;
+    while (0 == count || printed < uint64_t(count)) {
+      // check before polling, so no sample published before the end is missed
+      const bool finished = ring.finished();
+      samples.clear();
+      ring.poll(samples, 0 == count ? SIZE_MAX : count - printed);
+      for (const auto& sample : samples) {
+        std::cout << std::fixed << sample.sequence << "," << sample.timestamp
+                  << "," << sample.value << "\n";
+      }
+      std::cout << std::flush;
+      printed += samples.size();
+
+      if (finished && samples.empty()) {
+        break;
+      }
+      if (samples.empty()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+      }
+    }
+
+    if (ring.lost() > 0) {
+      std::cerr << ring.lost()
+                << " sample(s) were overwritten before they could be read, "
+                   "use a larger --shm-capacity or a shorter --interval-us\n";
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return -1;
+  }
+
+  return 0;
+}
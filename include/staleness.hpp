@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <analysis_util.hpp>
+
+/// first access of one method which returned a new value
+struct ValueChange {
+  uint64_t timestamp;
+  double value;
+};
+
+/**
+ * how late one method observed the value changes which all methods observed
+ */
+struct StalenessSummary {
+  std::string method;
+  /// value changes of this method
+  uint64_t changes = 0;
+  /// changes matched in all methods
+  uint64_t matched = 0;
+  /// matched changes this method observed first (ties count for every method)
+  uint64_t first = 0;
+  /// time from the first observation by any method to this method's
+  uint64_t median_ns = 0;
+  uint64_t p99_ns = 0;
+  uint64_t max_ns = 0;
+  double mean_ns = 0;
+};
+
+/**
+ * @returns value changes of a timestamp_value.csv file, the first sample is
+ * not a change
+ */
+static std::vector<ValueChange> loadValueChanges(
+    const std::filesystem::path& path) {
+  std::vector<ValueChange> changes;
+  bool have_value = false;
+  double last_value = 0;
+  forEachCsvSample(path, [&](uint64_t, const auto& sample) {
+    if (have_value && sample.second != last_value) {
+      changes.push_back({sample.first, sample.second});
+    }
+    have_value = true;
+    last_value = sample.second;
+  });
+  return changes;
+}
+
+/**
+ * Matches the value changes of methods which recorded the same sensor at the
+ * same time (record --concurrent) and measures how late each method saw
+ * them.
+ *
+ * The method with the most changes is the reference. A change of another
+ * method matches a reference change if it is the first one within half the
+ * median interval between reference changes. Only the timing is compared, not
+ * the values, as libsensors reports them scaled.
+ *
+ * @param changes value changes by method
+ * @returns summary by method, in order of the method names
+ * @throws std::runtime_error if less than two methods are given
+ */
+static std::vector<StalenessSummary> compareStaleness(
+    const std::map<std::string, std::vector<ValueChange>>& changes) {
+  if (changes.size() < 2) {
+    throw std::runtime_error("staleness needs the readings of at least two methods");
+  }
+
+  auto reference = std::max_element(
+      changes.begin(), changes.end(), [](const auto& a, const auto& b) {
+        return a.second.size() < b.second.size();
+      });
+  const auto& reference_changes = reference->second;
+
+  uint64_t tolerance = UINT64_MAX / 2;
+  if (reference_changes.size() >= 2) {
+    std::vector<uint64_t> intervals;
+    for (size_t i = 1; i < reference_changes.size(); ++i) {
+      intervals.push_back(reference_changes[i].timestamp -
+                          reference_changes[i - 1].timestamp);
+    }
+    std::nth_element(intervals.begin(),
+                     intervals.begin() + intervals.size() / 2,
+                     intervals.end());
+    tolerance = intervals[intervals.size() / 2] / 2;
+  }
+
+  std::vector<std::string> methods;
+  std::vector<const std::vector<ValueChange>*> method_changes;
+  for (const auto& [method, list] : changes) {
+    methods.push_back(method);
+    method_changes.push_back(&list);
+  }
+
+  std::vector<StalenessSummary> result(methods.size());
+  std::vector<std::vector<uint64_t>> staleness(methods.size());
+  // next unmatched change of every method
+  std::vector<size_t> cursor(methods.size(), 0);
+
+  for (const auto& change : reference_changes) {
+    const uint64_t earliest_allowed =
+        change.timestamp > tolerance ? change.timestamp - tolerance : 0;
+    std::vector<uint64_t> seen(methods.size());
+    bool all_seen = true;
+
+    for (size_t m = 0; m < methods.size(); ++m) {
+      const auto& list = *method_changes[m];
+      while (cursor[m] < list.size() &&
+             list[cursor[m]].timestamp < earliest_allowed) {
+        ++cursor[m];
+      }
+      if (cursor[m] < list.size() &&
+          list[cursor[m]].timestamp <= change.timestamp + tolerance) {
+        seen[m] = list[cursor[m]].timestamp;
+      } else {
+        all_seen = false;
+      }
+    }
+    if (!all_seen) {
+      continue;
+    }
+
+    const uint64_t first = *std::min_element(seen.begin(), seen.end());
+    for (size_t m = 0; m < methods.size(); ++m) {
+      staleness[m].push_back(seen[m] - first);
+      if (seen[m] == first) {
+        ++result[m].first;
+      }
+      ++cursor[m];
+    }
+  }
+
+  for (size_t m = 0; m < methods.size(); ++m) {
+    auto& summary = result[m];
+    auto& values = staleness[m];
+    summary.method = methods[m];
+    summary.changes = method_changes[m]->size();
+    summary.matched = values.size();
+    if (values.empty()) {
+      continue;
+    }
+
+    double sum = 0;
+    for (auto value : values) {
+      sum += value;
+    }
+    std::sort(values.begin(), values.end());
+    summary.median_ns = values[values.size() / 2];
+    summary.p99_ns = values[(values.size() - 1) * 99 / 100];
+    summary.max_ns = values.back();
+    summary.mean_ns = sum / values.size();
+  }
+  return result;
+}
+
+static std::string staleness_csv_header() {
+  return "method,changes,matched,first,staleness_median_ns,"
+         "staleness_p99_ns,staleness_max_ns,staleness_mean_ns";
+}
+
+/**
+ * compares when the methods of one directory observed the value changes, see
+ * compareStaleness()
+ *
+ * @returns 0 on success
+ * @returns -1 on failure
+ */
+int startStalenessAnalysis(const std::filesystem::path& dir, bool as_csv) {
+  std::map<std::string, std::vector<ValueChange>> changes;
+  try {
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+      std::string fname = entry.path().filename();
+      if (fname.ends_with("_timestamp_value.csv")) {
+        changes[fname.substr(0, fname.find("_"))] =
+            loadValueChanges(entry.path());
+      }
+    }
+
+    auto summaries = compareStaleness(changes);
+
+    if (!as_csv) {
+      std::cout << summaries.front().matched
+                << " value changes seen by all methods\n";
+    }
+    for (const auto& summary : summaries) {
+      if (as_csv) {
+        std::cout << summary.method << "," << summary.changes << ","
+                  << summary.matched << "," << summary.first << ","
+                  << summary.median_ns << "," << summary.p99_ns << ","
+                  << summary.max_ns << "," << summary.mean_ns << "\n";
+        continue;
+      }
+      std::cout << summary.method << ": first in " << summary.first << " of "
+                << summary.matched << " changes (" << summary.changes
+                << " total), staleness median " << summary.median_ns
+                << " ns, p99 " << summary.p99_ns << " ns, max "
+                << summary.max_ns << " ns\n";
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return -1;
+  }
+
+  return 0;
+}
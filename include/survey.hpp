@@ -0,0 +1,303 @@
+#pragma once
+
+#include <fnmatch.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <contention.hpp>
+#include <group_reader.hpp>
+#include <hwmondump_util.hpp>
+#include <libsensors_session.hpp>
+#include <sysfs_scan.hpp>
+
+/**
+ * access cost and update interval of one sensor read with one method
+ */
+struct SurveyResult {
+  std::string sensor;
+  std::string method;
+  /// cpu the sensor was read on
+  int cpu = -1;
+  uint64_t accesses = 0;
+  /// time between consecutive accesses
+  LatencySummary cost;
+  /// number of value changes
+  uint64_t changes = 0;
+  /// median time between value changes, 0 if less than two changes were seen
+  uint64_t update_interval_ns = 0;
+  /// empty if the sensor could be read
+  std::string error;
+};
+
+/// accesses before the measurement, also used to estimate the access time
+static constexpr size_t survey_warmup = 10;
+/// limit of the samples reserved up front, more are still taken if needed
+static constexpr size_t survey_max_reserved = 1 << 22;
+
+/**
+ * reads one sensor as often as possible during budget, after a short warmup
+ *
+ * The warmup estimates how many samples fit into budget, so the storage is
+ * allocated once. Samples are taken in chunks of about 1 % of budget with
+ * takeSamples(), and the deadline is checked between chunks only.
+ *
+ * @returns the result, with the error instead of any exception
+ */
+template <Reader R>
+SurveyResult surveySensor(const std::filesystem::path& path,
+                          std::chrono::milliseconds budget) {
+  SurveyResult result;
+  result.sensor = path.string();
+  result.method = R::methodname();
+
+  time_reading_storage storage;
+  try {
+    R reader(path);
+    const uint64_t warmup_start = gettimestampnano();
+    for (size_t i = 0; i < survey_warmup; ++i) {
+      reader.getvalue();
+    }
+    const uint64_t access_ns = std::max<uint64_t>(
+        (gettimestampnano() - warmup_start) / survey_warmup, 1);
+
+    const uint64_t expected =
+        std::chrono::nanoseconds(budget).count() / access_ns;
+    const size_t chunk = std::clamp<uint64_t>(expected / 100, 1, 1024);
+    storage.reserve(std::min<uint64_t>(expected + expected / 4,
+                                       survey_max_reserved) +
+                    chunk);
+
+    const auto end = std::chrono::steady_clock::now() + budget;
+    do {
+      const size_t taken = storage.size();
+      storage.resize(taken + chunk);
+      takeSamples(reader, std::span(storage).subspan(taken));
+    } while (std::chrono::steady_clock::now() < end);
+  } catch (const std::exception& e) {
+    result.error = e.what();
+    return result;
+  }
+
+  result.accesses = storage.size();
+  result.cost = accessLatencies(storage);
+  const auto updates = valueUpdates(storage);
+  result.changes = updates.changes;
+  result.update_interval_ns = updates.median_interval_ns;
+  return result;
+}
+
+/// surveys one sensor with one method, see surveySensor()
+using SurveyMethod = std::function<SurveyResult(const std::filesystem::path&,
+                                                std::chrono::milliseconds)>;
+
+/**
+ * @returns key of the bus the chip's device is attached to, chips with the
+ * same key must not be read at the same time
+ *
+ * Drivers serialize accesses to a chip, and chips behind one bus (e.g.
+ * I2C/SMBus) share it, so reading them in parallel would measure contention
+ * instead of the access cost. Chips without a device link get their own key.
+ */
+static std::string surveyBusKey(const std::filesystem::path& chip) {
+  std::error_code error;
+  auto device = std::filesystem::canonical(chip / "device", error);
+  if (error) {
+    return chip.string();
+  }
+  return device.parent_path().string();
+}
+
+/**
+ * Benchmarks every sensor with every method for budget each.
+ *
+ * Sensors are grouped by bus (see surveyBusKey()). Each group is surveyed
+ * sensor by sensor by one of jobs threads, job i is pinned to the i-th allowed
+ * cpu, so only sensors on different buses are read at the same time.
+ *
+ * @returns one result per sensor and method, sorted by sensor and method
+ * @throws std::runtime_error if a thread can not be pinned
+ */
+static std::vector<SurveyResult> survey(
+    const std::vector<HwmonAttribute>& sensors,
+    const std::vector<SurveyMethod>& methods,
+    std::chrono::milliseconds budget,
+    int jobs) {
+  std::map<std::string, std::vector<std::filesystem::path>> groups;
+  for (const auto& sensor : sensors) {
+    groups[surveyBusKey(sensor.chip_path)].push_back(sensor.full_path());
+  }
+  std::vector<const std::vector<std::filesystem::path>*> queue;
+  for (const auto& [key, paths] : groups) {
+    queue.push_back(&paths);
+  }
+
+  const auto allowed = allowedCpus();
+  const size_t workers =
+      std::max<size_t>(1, std::min<size_t>(jobs, queue.size()));
+  std::vector<std::vector<SurveyResult>> results(workers);
+  std::vector<std::exception_ptr> errors(workers);
+  std::atomic<size_t> next_group = 0;
+
+  std::vector<std::thread> threads;
+  for (size_t w = 0; w < workers; ++w) {
+    threads.emplace_back([&, w] {
+      try {
+        const int cpu = allowed[w % allowed.size()];
+        pinCurrentThread(cpu);
+        for (size_t g = next_group++; g < queue.size(); g = next_group++) {
+          for (const auto& path : *queue[g]) {
+            for (const auto& method : methods) {
+              results[w].push_back(method(path, budget));
+              results[w].back().cpu = cpu;
+            }
+          }
+        }
+      } catch (...) {
+        errors[w] = std::current_exception();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  std::vector<SurveyResult> all;
+  for (auto& worker_results : results) {
+    std::move(worker_results.begin(), worker_results.end(),
+              std::back_inserter(all));
+  }
+  std::sort(all.begin(), all.end(), [](const auto& a, const auto& b) {
+    return a.sensor != b.sensor ? a.sensor < b.sensor : a.method < b.method;
+  });
+  return all;
+}
+
+static std::string survey_csv_header() {
+  return "sensor,method,cpu,accesses,cost_median_ns,cost_p99_ns,cost_max_ns,"
+         "changes,update_interval_median_ns,error";
+}
+
+/**
+ * prints results as CSV, errors are quoted
+ */
+static void outputSurvey(const std::vector<SurveyResult>& results,
+                         std::ostream& out) {
+  out << survey_csv_header() << "\n";
+  for (const auto& result : results) {
+    std::string error = result.error;
+    std::replace(error.begin(), error.end(), '"', '\'');
+    out << result.sensor << "," << result.method << "," << result.cpu << ","
+        << result.accesses << "," << result.cost.median_ns << ","
+        << result.cost.p99_ns << "," << result.cost.max_ns << ","
+        << result.changes << "," << result.update_interval_ns << ",";
+    if (!error.empty()) {
+      out << "\"" << error << "\"";
+    }
+    out << "\n";
+  }
+}
+
+/**
+ * benchmarks all sensors matching --attributes with the selected methods and
+ * prints one CSV row per sensor and method, see survey()
+ * @returns 0 on success
+ * @returns -1 on failure
+ */
+int surveySubcommand(argparse::ArgumentParser& survey_command) {
+  const int budget_ms = survey_command.get<int>("--budget-ms");
+  if (budget_ms <= 0) {
+    std::cerr << "budget must be at least 1 ms\n";
+    return -1;
+  }
+  const int jobs = survey_command.get<int>("--jobs");
+  if (jobs <= 0 || jobs > 1024) {
+    std::cerr << "number of jobs must be between 1 and 1024\n";
+    return -1;
+  }
+
+  try {
+    // keeps libsensors initialized for all ReaderLibsens of the survey
+    std::shared_ptr<LibsensorsSession> session;
+    std::vector<SurveyMethod> methods;
+    if (survey_command.get<bool>("--sysfs")) {
+      methods.push_back(surveySensor<ReaderSysfs>);
+    }
+    if (survey_command.get<bool>("--sysfs-lseek")) {
+      methods.push_back(surveySensor<ReaderLseek>);
+    }
+    if (survey_command.get<bool>("--libsensors")) {
+      session = LibsensorsSession::acquire();
+      methods.push_back(surveySensor<ReaderLibsens>);
+    }
+    if (methods.empty()) {
+      methods.push_back(surveySensor<ReaderSysfs>);
+      methods.push_back(surveySensor<ReaderLseek>);
+    }
+
+    std::vector<HwmonAttribute> candidates;
+    if (survey_command.get<bool>("--from-libsensors")) {
+      if (!session) {
+        session = LibsensorsSession::acquire();
+      }
+      for (const auto& sensor : session->list().sensors) {
+        candidates.push_back({
+            .chip_path = sensor.chip_path,
+            .subfeature_name = sensor.subfeature_name,
+            .feature_name = sensor.feature_name,
+            .value = {},
+        });
+      }
+    } else {
+      candidates =
+          scanHwmonTree(survey_command.get<std::string>("--hwmon-root"));
+    }
+
+    const auto globs =
+        parseGlobList(survey_command.get<std::string>("--attributes"));
+    std::vector<HwmonAttribute> sensors;
+    for (const auto& candidate : candidates) {
+      for (const auto& glob : globs) {
+        if (0 == fnmatch(glob.c_str(), candidate.subfeature_name.c_str(), 0)) {
+          sensors.push_back(candidate);
+          break;
+        }
+      }
+    }
+    if (sensors.empty()) {
+      std::cerr << "no sensor matches "
+                << survey_command.get<std::string>("--attributes") << "\n";
+      return -1;
+    }
+
+    std::cerr << "surveying " << sensors.size() << " sensor(s) with "
+              << methods.size() << " method(s) for " << budget_ms
+              << " ms each...\n";
+    outputSurvey(survey(sensors, methods, std::chrono::milliseconds(budget_ms),
+                        jobs),
+                 std::cout);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * one attribute file of a hwmon chip, named like libsensors would
+ */
+struct HwmonAttribute {
+  /// directory of chip, e.g. /sys/class/hwmon/hwmon5
+  std::string chip_path;
+  /// attribute file, e.g. temp1_input
+  std::string subfeature_name;
+  /// e.g. temp1
+  std::string feature_name;
+  /// content without surrounding whitespace, only if read, "NA" if not
+  /// readable
+  std::string value;
+
+  std::string full_path() const { return chip_path + "/" + subfeature_name; }
+};
+
+/**
+ * @returns true if the filename is a sensor attribute as defined in the
+ * kernel hwmon sysfs interface, i.e. <type><number>_<item>
+ */
+static bool isHwmonAttribute(const std::string& fname, std::string& feature) {
+  static const std::regex attribute_regex(
+      "^((in|fan|temp|power|energy|curr|humidity|intrusion)[0-9]+)_[a-z_]+$");
+
+  std::smatch match;
+  if (!std::regex_match(fname, match, attribute_regex)) {
+    return false;
+  }
+
+  feature = match[1];
+  return true;
+}
+
+/**
+ * @returns type of an attribute, e.g. temp for temp1_input
+ */
+static std::string hwmonAttributeType(const std::string& subfeature) {
+  return subfeature.substr(0, subfeature.find_first_of("0123456789"));
+}
+
+/**
+ * @returns unit of the attribute value as given in the kernel hwmon sysfs
+ * interface, empty for flags, labels and modes
+ */
+static std::string hwmonAttributeUnit(const std::string& subfeature) {
+  const std::string item = subfeature.substr(subfeature.find('_') + 1);
+  if (item.ends_with("alarm") || item == "beep" || item == "enable" ||
+      item == "fault" || item == "label" || item == "type" || item == "mode" ||
+      item == "pulses" || item == "div") {
+    return "";
+  }
+
+  const std::string type = hwmonAttributeType(subfeature);
+  if ("temp" == type) {
+    return "millidegree Celsius";
+  } else if ("in" == type) {
+    return "millivolt";
+  } else if ("curr" == type) {
+    return "milliampere";
+  } else if ("power" == type) {
+    return "microwatt";
+  } else if ("energy" == type) {
+    return "microjoule";
+  } else if ("fan" == type) {
+    return "RPM";
+  } else if ("humidity" == type) {
+    return "milli-percent";
+  }
+  return "";
+}
+
+/// one entry of a directory as reported by getdents64()
+struct DirectoryEntry {
+  std::string name;
+  unsigned char type;
+};
+
+/**
+ * lists a directory with raw getdents64() calls, without the allocations and
+ * stat() calls of std::filesystem
+ * @throws std::runtime_error if the directory can not be read
+ */
+static std::vector<DirectoryEntry> listDirectory(int dirfd) {
+  struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+  };
+
+  std::vector<DirectoryEntry> entries;
+  alignas(linux_dirent64) char buffer[32768];
+  for (;;) {
+    long bytes = syscall(SYS_getdents64, dirfd, buffer, sizeof(buffer));
+    if (bytes < 0) {
+      throw std::runtime_error("could not list directory");
+    }
+    if (0 == bytes) {
+      return entries;
+    }
+    for (long offset = 0; offset < bytes;) {
+      auto* entry = reinterpret_cast<linux_dirent64*>(buffer + offset);
+      offset += entry->d_reclen;
+      std::string name(entry->d_name);
+      if ("." != name && ".." != name) {
+        entries.push_back({std::move(name), entry->d_type});
+      }
+    }
+  }
+}
+
+/**
+ * @returns all attributes of one chip, relative to the open chip directory
+ */
+static std::vector<HwmonAttribute> scanHwmonChip(int chipfd,
+                                                 const std::string& chip_path,
+                                                 bool read_values) {
+  std::vector<HwmonAttribute> attributes;
+
+  for (const auto& entry : listDirectory(chipfd)) {
+    std::string feature;
+    if (!isHwmonAttribute(entry.name, feature)) {
+      continue;
+    }
+    // sysfs reports attributes as regular files, follow anything else
+    if (DT_REG != entry.type) {
+      struct stat info;
+      if (0 != fstatat(chipfd, entry.name.c_str(), &info, 0) ||
+          !S_ISREG(info.st_mode)) {
+        continue;
+      }
+    }
+
+    HwmonAttribute attribute{
+        .chip_path = chip_path,
+        .subfeature_name = entry.name,
+        .feature_name = feature,
+        .value = {},
+    };
+    if (read_values) {
+      attribute.value = "NA";
+      int fd = openat(chipfd, entry.name.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd >= 0) {
+        char content[256];
+        ssize_t bytes = pread(fd, content, sizeof(content), 0);
+        if (bytes > 0) {
+          std::string content_string(content, bytes);
+          const auto first = content_string.find_first_not_of(" \t\r\n");
+          if (std::string::npos != first) {
+            attribute.value = content_string.substr(
+                first, content_string.find_last_not_of(" \t\r\n") - first + 1);
+          } else {
+            attribute.value.clear();
+          }
+        }
+        close(fd);
+      }
+    }
+    attributes.push_back(std::move(attribute));
+  }
+
+  return attributes;
+}
+
+/**
+ * lists all sensor attributes below a hwmon class directory without using
+ * libsensors
+ *
+ * The chips are scanned in parallel, each directory is listed with
+ * getdents64() and opened relative to its parent with openat(), so even
+ * hundreds of attributes are listed within milliseconds.
+ *
+ * @param root directory containing the chips, usually /sys/class/hwmon
+ * @param read_values also read the current content of every attribute
+ * @throws std::runtime_error if root is not a directory
+ */
+std::vector<HwmonAttribute> scanHwmonTree(const std::filesystem::path& root,
+                                          bool read_values = false) {
+  int rootfd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (rootfd < 0) {
+    throw std::runtime_error("not a directory: " + root.string());
+  }
+
+  std::vector<std::string> chips;
+  try {
+    for (const auto& entry : listDirectory(rootfd)) {
+      if (entry.name.starts_with("hwmon")) {
+        chips.push_back(entry.name);
+      }
+    }
+  } catch (const std::exception&) {
+    close(rootfd);
+    throw std::runtime_error("could not list " + root.string());
+  }
+
+  std::vector<std::vector<HwmonAttribute>> per_chip(chips.size());
+  std::atomic<size_t> next_chip = 0;
+  auto scan = [&]() {
+    for (size_t i = next_chip++; i < chips.size(); i = next_chip++) {
+      // in /sys/class/hwmon the chips are symlinks, O_DIRECTORY follows them
+      // and skips anything else
+      int chipfd = openat(rootfd, chips[i].c_str(),
+                          O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (chipfd < 0) {
+        continue;
+      }
+      try {
+        per_chip[i] =
+            scanHwmonChip(chipfd, (root / chips[i]).string(), read_values);
+      } catch (const std::exception&) {
+        // chip vanished while scanning, e.g. driver unloaded
+      }
+      close(chipfd);
+    }
+  };
+
+  const size_t workers = std::min<size_t>(
+      chips.size(), std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < workers; ++i) {
+    threads.emplace_back(scan);
+  }
+  scan();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  close(rootfd);
+
+  std::vector<HwmonAttribute> attributes;
+  for (auto& chip_attributes : per_chip) {
+    std::move(chip_attributes.begin(), chip_attributes.end(),
+              std::back_inserter(attributes));
+  }
+
+  std::sort(attributes.begin(), attributes.end(),
+            [](const auto& a, const auto& b) {
+              return a.full_path() < b.full_path();
+            });
+  return attributes;
+}
+
+/**
+ * prints attributes in the same format as hwmondump list
+ *
+ * @param values append the value column, see scanHwmonTree()
+ * @param types append the type and unit columns
+ */
+void outputHwmonAttributes(const std::vector<HwmonAttribute>& attributes,
+                           bool values = false,
+                           bool types = false) {
+  std::cout << "full_path;chip_path;subfeature;feature";
+  if (values) {
+    std::cout << ";value";
+  }
+  if (types) {
+    std::cout << ";type;unit";
+  }
+  std::cout << "\n";
+
+  for (const auto& attribute : attributes) {
+    std::cout << attribute.full_path() << ";" << attribute.chip_path << "/;"
+              << attribute.subfeature_name << ";" << attribute.feature_name;
+    if (values) {
+      std::cout << ";" << attribute.value;
+    }
+    if (types) {
+      std::cout << ";" << hwmonAttributeType(attribute.subfeature_name) << ";"
+                << hwmonAttributeUnit(attribute.subfeature_name);
+    }
+    std::cout << "\n";
+  }
+}
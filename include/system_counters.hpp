@@ -0,0 +1,460 @@
+#pragma once
+
+#include <sched.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <analysis_util.hpp>
+#include <timestamp_util.hpp>
+
+static const std::string fname_suffix_system_counters = "_system_counters.csv";
+
+/**
+ * Snapshot of counters that explain why a sensor access took unusually long:
+ * context switches of this process, and interrupts/softirqs of the whole
+ * system and of the CPU the benchmark was running on.
+ */
+struct SystemCounters {
+  /// same clock as gettimestampnano()
+  uint64_t timestamp = 0;
+  uint64_t voluntary_ctxt_switches = 0;
+  uint64_t nonvoluntary_ctxt_switches = 0;
+  /// sum of all lines of /proc/interrupts over all CPUs
+  uint64_t interrupts = 0;
+  /// sum of all lines of /proc/softirqs over all CPUs
+  uint64_t softirqs = 0;
+  /// interrupts on the CPU the benchmark started on
+  uint64_t cpu_interrupts = 0;
+  /// softirqs on the CPU the benchmark started on
+  uint64_t cpu_softirqs = 0;
+
+  static std::string csv_header() {
+    return "nanoseconds,voluntary_ctxt_switches,nonvoluntary_ctxt_switches,"
+           "interrupts,softirqs,cpu_interrupts,cpu_softirqs";
+  }
+
+  std::string csv() const {
+    return std::to_string(timestamp) + "," +
+           std::to_string(voluntary_ctxt_switches) + "," +
+           std::to_string(nonvoluntary_ctxt_switches) + "," +
+           std::to_string(interrupts) + "," + std::to_string(softirqs) + "," +
+           std::to_string(cpu_interrupts) + "," + std::to_string(cpu_softirqs);
+  }
+
+  /// @returns counter increase from earlier to this, timestamp is the window
+  SystemCounters operator-(const SystemCounters& earlier) const {
+    return {
+        .timestamp = timestamp - earlier.timestamp,
+        .voluntary_ctxt_switches =
+            voluntary_ctxt_switches - earlier.voluntary_ctxt_switches,
+        .nonvoluntary_ctxt_switches =
+            nonvoluntary_ctxt_switches - earlier.nonvoluntary_ctxt_switches,
+        .interrupts = interrupts - earlier.interrupts,
+        .softirqs = softirqs - earlier.softirqs,
+        .cpu_interrupts = cpu_interrupts - earlier.cpu_interrupts,
+        .cpu_softirqs = cpu_softirqs - earlier.cpu_softirqs,
+    };
+  }
+};
+
+/**
+ * @returns full content of a (proc) file
+ * @throws std::runtime_error if file can not be opened
+ */
+static std::string readWholeFile(const std::filesystem::path& path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("could not open " + path.string());
+  }
+
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+/**
+ * sums up a table in the format of /proc/interrupts or /proc/softirqs:
+ * a header line with one "CPUn" column per online CPU, then one line per
+ * source with a label followed by one counter per CPU
+ *
+ * lines with fewer counters (e.g. "ERR:" in /proc/interrupts) are summed up
+ * as far as present
+ *
+ * @param cpu CPU number to sum separately into on_cpu, -1 to skip
+ */
+void sumProcCpuTable(const std::string& content,
+                     int cpu,
+                     uint64_t& total,
+                     uint64_t& on_cpu) {
+  total = 0;
+  on_cpu = 0;
+
+  std::istringstream lines(content);
+  std::string header;
+  if (!getline(lines, header)) {
+    return;
+  }
+
+  // determine columns from header
+  std::istringstream header_tokens(header);
+  size_t columns = 0;
+  int cpu_column = -1;
+  for (std::string token; header_tokens >> token;) {
+    if (token == "CPU" + std::to_string(cpu)) {
+      cpu_column = columns;
+    }
+    ++columns;
+  }
+
+  for (std::string line; getline(lines, line);) {
+    auto colon = line.find(':');
+    if (std::string::npos == colon) {
+      continue;
+    }
+
+    const char* pos = line.c_str() + colon + 1;
+    for (size_t column = 0; column < columns; ++column) {
+      char* end;
+      uint64_t count = std::strtoull(pos, &end, 10);
+      if (end == pos) {
+        // reached the description text of this line
+        break;
+      }
+
+      total += count;
+      if (int(column) == cpu_column) {
+        on_cpu += count;
+      }
+      pos = end;
+    }
+  }
+}
+
+/**
+ * reads all counters once
+ * @param cpu CPU for the cpu_* counters
+ * @throws std::runtime_error if a proc file is not accessible
+ */
+SystemCounters takeSystemCounters(int cpu) {
+  SystemCounters counters;
+  counters.timestamp = gettimestampnano();
+
+  std::istringstream status(readWholeFile("/proc/self/status"));
+  for (std::string line; getline(status, line);) {
+    if (line.starts_with("voluntary_ctxt_switches:")) {
+      counters.voluntary_ctxt_switches =
+          std::stoull(line.substr(line.find(':') + 1));
+    } else if (line.starts_with("nonvoluntary_ctxt_switches:")) {
+      counters.nonvoluntary_ctxt_switches =
+          std::stoull(line.substr(line.find(':') + 1));
+    }
+  }
+
+  sumProcCpuTable(readWholeFile("/proc/interrupts"), cpu, counters.interrupts,
+                  counters.cpu_interrupts);
+  sumProcCpuTable(readWholeFile("/proc/softirqs"), cpu, counters.softirqs,
+                  counters.cpu_softirqs);
+
+  return counters;
+}
+
+/**
+ * Takes SystemCounters snapshots before and after a measurement, and
+ * optionally at a fixed interval from a side thread in between.
+ *
+ * Must be started from the thread that runs the benchmark: its current CPU is
+ * used for the cpu_* counters, and /proc/self/status reports the context
+ * switches of the main thread. Pin hwmondump (e.g. with taskset) for
+ * meaningful per-CPU numbers.
+ */
+class SystemCounterSampler {
+ private:
+  std::chrono::milliseconds interval_;
+  int cpu_ = -1;
+  std::vector<SystemCounters> samples_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable stop_cv_;
+  bool stop_requested_ = false;
+
+  void sampleLoop() {
+    auto next = std::chrono::steady_clock::now() + interval_;
+    std::unique_lock lock(mutex_);
+
+    while (!stop_cv_.wait_until(lock, next, [this] { return stop_requested_; })) {
+      samples_.push_back(takeSystemCounters(cpu_));
+      next += interval_;
+    }
+  }
+
+ public:
+  /**
+   * @param interval_ms sample interval of side thread, 0 = only before/after
+   */
+  SystemCounterSampler(int interval_ms) : interval_(interval_ms) {}
+
+  /// takes first snapshot and starts side thread if requested
+  void start() {
+    cpu_ = sched_getcpu();
+    samples_.clear();
+    samples_.push_back(takeSystemCounters(cpu_));
+
+    if (interval_.count() > 0) {
+      stop_requested_ = false;
+      thread_ = std::thread(&SystemCounterSampler::sampleLoop, this);
+    }
+  }
+
+  /// stops side thread and takes last snapshot
+  void stop() {
+    if (thread_.joinable()) {
+      {
+        std::lock_guard lock(mutex_);
+        stop_requested_ = true;
+      }
+      stop_cv_.notify_all();
+      thread_.join();
+    }
+
+    samples_.push_back(takeSystemCounters(cpu_));
+  }
+
+  /// CPU used for the cpu_* counters
+  int cpu() const { return cpu_; }
+
+  const std::vector<SystemCounters>& samples() const { return samples_; }
+
+  /// @returns difference between last and first snapshot
+  SystemCounters total() const { return samples_.back() - samples_.front(); }
+
+  /**
+   * stores all snapshots as csv
+   * @throws std::runtime_error if file can not be opened
+   */
+  void save(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+      throw std::runtime_error("output file not open");
+    }
+
+    file << SystemCounters::csv_header() << "\n";
+    for (const auto& sample : samples_) {
+      file << sample.csv() << "\n";
+    }
+  }
+
+  ~SystemCounterSampler() {
+    if (thread_.joinable()) {
+      stop();
+    }
+  }
+};
+
+/**
+ * reads a file written by SystemCounterSampler::save()
+ * @throws std::runtime_error if file can not be opened or is malformed
+ */
+std::vector<SystemCounters> loadSystemCounters(
+    const std::filesystem::path& path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("csv file not open: " + path.string());
+  }
+
+  std::vector<SystemCounters> samples;
+  bool first = true;
+  for (std::string line; getline(file, line);) {
+    if (first) {
+      first = false;
+      continue;
+    }
+
+    SystemCounters c;
+    char sep;
+    std::istringstream fields(line);
+    fields >> c.timestamp >> sep >> c.voluntary_ctxt_switches >> sep >>
+        c.nonvoluntary_ctxt_switches >> sep >> c.interrupts >> sep >>
+        c.softirqs >> sep >> c.cpu_interrupts >> sep >> c.cpu_softirqs;
+    if (fields.fail()) {
+      throw std::runtime_error("malformed line in " + path.string() + ": " +
+                               line);
+    }
+    samples.push_back(c);
+  }
+
+  return samples;
+}
+
+/// gap between two consecutive sensor accesses
+struct TimestampGap {
+  /// timestamp of the access before the gap
+  uint64_t start;
+  /// nanoseconds until the next access
+  uint64_t length;
+};
+
+/**
+ * finds the largest gaps between consecutive timestamps of a
+ * timestamp_value.csv file in one pass, keeping only count gaps in memory
+ * @returns gaps, largest first
+ */
+std::vector<TimestampGap> findLargestGaps(const std::filesystem::path& path,
+                                          size_t count) {
+  auto larger = [](const TimestampGap& a, const TimestampGap& b) {
+    return a.length > b.length;
+  };
+  // min-heap: top is the smallest of the largest gaps found so far
+  std::priority_queue<TimestampGap, std::vector<TimestampGap>,
+                      decltype(larger)>
+      heap(larger);
+
+  std::optional<uint64_t> previous;
+  forEachCsvSample(path, [&](uint64_t, const auto& sample) {
+    if (previous) {
+      TimestampGap gap{*previous, sample.first - *previous};
+      if (heap.size() < count) {
+        heap.push(gap);
+      } else if (count > 0 && gap.length > heap.top().length) {
+        heap.pop();
+        heap.push(gap);
+      }
+    }
+    previous = sample.first;
+  });
+
+  std::vector<TimestampGap> gaps;
+  while (!heap.empty()) {
+    gaps.push_back(heap.top());
+    heap.pop();
+  }
+  std::reverse(gaps.begin(), gaps.end());
+  return gaps;
+}
+
+/**
+ * @returns counter increase over the smallest sampled window that contains
+ * the whole gap, nothing if the gap is not covered by samples
+ */
+std::optional<SystemCounters> countersAroundGap(
+    const std::vector<SystemCounters>& samples,
+    const TimestampGap& gap) {
+  auto by_time = [](const SystemCounters& c, uint64_t t) {
+    return c.timestamp < t;
+  };
+
+  // first sample at or after the end of the gap
+  auto after = std::lower_bound(samples.begin(), samples.end(),
+                                gap.start + gap.length, by_time);
+  // last sample at or before the start of the gap
+  auto before = std::upper_bound(
+      samples.begin(), samples.end(), gap.start,
+      [](uint64_t t, const SystemCounters& c) { return t < c.timestamp; });
+
+  if (before == samples.begin() || after == samples.end()) {
+    return {};
+  }
+  --before;
+
+  return *after - *before;
+}
+
+static std::string gap_csv_header() {
+  return "method,gap_start_ns,gap_ns,window_ns,voluntary_ctxt_switches,"
+         "nonvoluntary_ctxt_switches,interrupts,softirqs,cpu_interrupts,"
+         "cpu_softirqs";
+}
+
+/**
+ * lists the largest gaps of every timestamp_value.csv file in a directory,
+ * together with the system counter deltas around them (if the recording was
+ * done with --system-counters)
+ *
+ * @returns 0 on success
+ * @returns -1 on failure
+ */
+int startGapAnalysis(const std::filesystem::path& dir,
+                     int count,
+                     bool as_csv) {
+  if (count <= 0) {
+    std::cerr << "number of gaps must be at least 1\n";
+    return -1;
+  }
+
+  std::vector<std::filesystem::path> inputs;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.path().string().ends_with("_timestamp_value.csv")) {
+      inputs.push_back(entry.path());
+    }
+  }
+  std::sort(inputs.begin(), inputs.end());
+
+  if (inputs.empty()) {
+    std::cerr << "No files to analyze, directory doesn't contain output "
+                 "files\n";
+    return -1;
+  }
+
+  for (const auto& input : inputs) {
+    std::string fname = input.filename();
+    std::string method = fname.substr(0, fname.find("_"));
+
+    std::vector<SystemCounters> counters;
+    auto counters_path = dir / (method + fname_suffix_system_counters);
+    if (std::filesystem::exists(counters_path)) {
+      counters = loadSystemCounters(counters_path);
+    }
+
+    auto gaps = findLargestGaps(input, count);
+
+    if (!as_csv) {
+      std::cout << method << ": " << gaps.size() << " largest gaps\n";
+    }
+
+    for (const auto& gap : gaps) {
+      auto delta = countersAroundGap(counters, gap);
+
+      if (as_csv) {
+        std::cout << method << "," << gap.start << "," << gap.length << ",";
+        if (delta) {
+          std::cout << delta->csv() << "\n";
+        } else {
+          std::cout << "NA,NA,NA,NA,NA,NA,NA\n";
+        }
+        continue;
+      }
+
+      std::cout << "    " << gap.length << " ns at " << gap.start;
+      if (delta) {
+        std::cout << ": window " << delta->timestamp << " ns, ctxt switches +"
+                  << delta->voluntary_ctxt_switches << " voluntary +"
+                  << delta->nonvoluntary_ctxt_switches
+                  << " involuntary, interrupts +" << delta->interrupts
+                  << " (cpu +" << delta->cpu_interrupts << "), softirqs +"
+                  << delta->softirqs << " (cpu +" << delta->cpu_softirqs
+                  << ")";
+      } else {
+        std::cout << ": no system counters available";
+      }
+      std::cout << "\n";
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @returns timestamp in nanoseconds
+ */
+uint64_t gettimestampnano() {
+  // get epoch point
+  auto since_epoch =
+      std::chrono::high_resolution_clock::now().time_since_epoch();
+
+  // return nanoseconds
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch)
+      .count();
+}
@@ -0,0 +1,382 @@
+#pragma once
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <phase_timer.hpp>
+#include <serve.hpp>
+#include <timestamp_util.hpp>
+
+/**
+ * output format of hwmondump watch
+ */
+enum class WatchFormat {
+  /// sensor,nanoseconds,value with header
+  csv,
+  /// one object per line
+  json,
+};
+
+/**
+ * @throws std::runtime_error for unknown names
+ */
+static WatchFormat parseWatchFormat(const std::string& name) {
+  if ("csv" == name) {
+    return WatchFormat::csv;
+  } else if ("json" == name) {
+    return WatchFormat::json;
+  }
+  throw std::runtime_error("unknown format: " + name + ", use csv or json");
+}
+
+/**
+ * Collects output in memory and writes it with a single write(2) once
+ * interval passed since the last write, so fast sampling does not cost a
+ * system call per line.
+ */
+class OutputBuffer {
+ private:
+  int fd_;
+  uint64_t interval_ns_;
+  uint64_t last_flush_ = 0;
+  std::string buffer_;
+  uint64_t writes_ = 0;
+  bool closed_ = false;
+
+ public:
+  /// @param interval_ns 0 to write on every flushIfDue()
+  OutputBuffer(int fd, uint64_t interval_ns)
+      : fd_(fd), interval_ns_(interval_ns) {
+    buffer_.reserve(1 << 16);
+  }
+
+  void append(std::string_view text) { buffer_ += text; }
+
+  /// appends the decimal representation of number
+  template <typename T>
+  void appendNumber(T number) {
+    char digits[64];
+    std::to_chars_result result;
+    if constexpr (std::is_floating_point_v<T>) {
+      result = std::to_chars(digits, digits + sizeof(digits), number,
+                             std::chars_format::fixed, 6);
+    } else {
+      result = std::to_chars(digits, digits + sizeof(digits), number);
+    }
+    buffer_.append(digits, result.ptr);
+  }
+
+  /**
+   * writes everything buffered
+   * @returns false if the output was closed (e.g. end of a pipe)
+   */
+  bool flush() {
+    for (size_t written = 0; written < buffer_.size() && !closed_;) {
+      const ssize_t result = write(fd_, buffer_.data() + written,
+                                   buffer_.size() - written);
+      if (result < 0 && EINTR != errno) {
+        closed_ = true;
+      } else if (result > 0) {
+        written += result;
+      }
+    }
+    if (!buffer_.empty()) {
+      ++writes_;
+    }
+    buffer_.clear();
+    return !closed_;
+  }
+
+  /// flush() if interval passed since the last write, see flush()
+  bool flushIfDue(uint64_t now_ns) {
+    if (now_ns - last_flush_ < interval_ns_ && buffer_.size() < (1 << 16)) {
+      return !closed_;
+    }
+    last_flush_ = now_ns;
+    return flush();
+  }
+
+  /// number of write(2) calls with data so far
+  uint64_t writes() const { return writes_; }
+};
+
+/**
+ * @returns text as JSON string, including the quotes
+ */
+static std::string jsonString(const std::string& text) {
+  std::string quoted = "\"";
+  for (const char c : text) {
+    if ('"' == c || '\\' == c) {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      quoted += escaped;
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+/// @returns CLOCK_MONOTONIC in ns, the clock of the watch deadlines
+static uint64_t monotonicNano() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * what hwmondump watch does and what it cost
+ */
+struct WatchSummary {
+  /// rounds of reading every sensor
+  uint64_t rounds = 0;
+  uint64_t samples = 0;
+  uint64_t errors = 0;
+  /// samples printed, fewer than samples with changes_only
+  uint64_t lines = 0;
+  /// write(2) calls for the output
+  uint64_t writes = 0;
+  /// deadlines skipped because a round took longer than the period
+  uint64_t missed = 0;
+  /// time of a single access
+  double access_mean_ns = 0;
+  uint64_t access_max_ns = 0;
+  /// wall time, cpu time and peak rss of the whole run
+  PhaseTiming usage;
+};
+
+/**
+ * options of hwmondump watch
+ */
+struct WatchOptions {
+  int rate_hz = 10;
+  WatchFormat format = WatchFormat::csv;
+  /// print a sample only if the value differs from the last one printed
+  bool changes_only = false;
+  /// stop after this many rounds, 0 = no limit
+  uint64_t rounds = 0;
+  /// stop after this time, 0 = no limit
+  uint64_t duration_ns = 0;
+  /// write the output at most this often, 0 = every round
+  uint64_t flush_interval_ns = 100000000;
+};
+
+/**
+ * Reads every sensor once per round, rounds at fixed deadlines of
+ * options.rate_hz, and streams the samples to fd until a limit of options is
+ * reached, one of signals arrives or fd is closed.
+ *
+ * The loop waits for the next deadline in sigtimedwait(), so signals must be
+ * blocked by the caller. Rounds which can not be kept up with are skipped.
+ *
+ * @returns what was done, the first read error of every sensor is printed to
+ * errors
+ */
+static WatchSummary watch(std::vector<ServedSensor>& sensors,
+                          const WatchOptions& options,
+                          int fd,
+                          const sigset_t& signals,
+                          std::ostream& errors) {
+  // prefix of every line of a sensor, formatted once
+  std::vector<std::string> prefixes;
+  for (const auto& sensor : sensors) {
+    if (WatchFormat::json == options.format) {
+      prefixes.push_back("{\"sensor\":" + jsonString(sensor.path.string()) +
+                         ",\"timestamp_ns\":");
+    } else {
+      prefixes.push_back(sensor.path.string() + ",");
+    }
+  }
+  std::vector<std::optional<double>> printed(sensors.size());
+  std::vector<bool> failed(sensors.size(), false);
+
+  WatchSummary summary;
+  OutputBuffer out(fd, options.flush_interval_ns);
+  if (WatchFormat::csv == options.format) {
+    out.append("sensor,nanoseconds,value\n");
+  }
+
+  PhaseTimer timer;
+  timer.start("watch");
+  const uint64_t period_ns = 1000000000ull / options.rate_hz;
+  const uint64_t start = monotonicNano();
+  uint64_t deadline = start;
+  double access_sum_ns = 0;
+
+  bool running = true;
+  while (running) {
+    for (size_t i = 0; i < sensors.size(); ++i) {
+      const uint64_t timestamp = gettimestampnano();
+      double value;
+      try {
+        value = sensors[i].read();
+      } catch (const std::exception& e) {
+        ++summary.errors;
+        if (!failed[i]) {
+          failed[i] = true;
+          errors << sensors[i].path.string() << ": " << e.what() << "\n";
+        }
+        continue;
+      }
+      const uint64_t cost = gettimestampnano() - timestamp;
+      access_sum_ns += cost;
+      summary.access_max_ns = std::max(summary.access_max_ns, cost);
+      ++summary.samples;
+
+      if (options.changes_only && printed[i] == value) {
+        continue;
+      }
+      printed[i] = value;
+      ++summary.lines;
+      out.append(prefixes[i]);
+      out.appendNumber(timestamp);
+      out.append(WatchFormat::json == options.format ? ",\"value\":" : ",");
+      if (WatchFormat::json == options.format && !std::isfinite(value)) {
+        // JSON has no numbers for nan and inf
+        out.append("null");
+      } else {
+        out.appendNumber(value);
+      }
+      out.append(WatchFormat::json == options.format ? "}\n" : "\n");
+    }
+    ++summary.rounds;
+
+    const bool open = out.flushIfDue(monotonicNano());
+    // the write may have taken a while, so the wait starts after it
+    const uint64_t now = monotonicNano();
+    running = open &&
+              (0 == options.rounds || summary.rounds < options.rounds) &&
+              (0 == options.duration_ns || now - start < options.duration_ns);
+
+    deadline += period_ns;
+    for (; deadline < now; deadline += period_ns) {
+      ++summary.missed;
+    }
+    if (running) {
+      const timespec timeout = {.tv_sec = time_t((deadline - now) / 1000000000),
+                                .tv_nsec = long((deadline - now) % 1000000000)};
+      int received;
+      while ((received = sigtimedwait(&signals, nullptr, &timeout)) < 0 &&
+             EINTR == errno) {
+      }
+      running = received < 0;
+    }
+  }
+  out.flush();
+  timer.stop();
+
+  summary.writes = out.writes();
+  summary.usage = timer.phases().back();
+  if (summary.samples > 0) {
+    summary.access_mean_ns = access_sum_ns / summary.samples;
+  }
+  return summary;
+}
+
+/**
+ * prints the samples of the given sensors to stdout until Ctrl-C, a limit or
+ * the end of the pipe, then its own overhead to stderr
+ * @returns 0 on success
+ * @returns -1 on failure
+ */
+int watchSubcommand(argparse::ArgumentParser& watch_command) {
+  WatchOptions options;
+  options.rate_hz = watch_command.get<int>("--rate");
+  if (options.rate_hz <= 0 || options.rate_hz > 100000) {
+    std::cerr << "rate must be between 1 Hz and 100 kHz\n";
+    return -1;
+  }
+  if (watch_command.is_used("--count")) {
+    const int rounds = watch_command.get<int>("--count");
+    if (rounds <= 0) {
+      std::cerr << "count must be positive\n";
+      return -1;
+    }
+    options.rounds = rounds;
+  }
+  if (watch_command.is_used("--duration")) {
+    const int duration = watch_command.get<int>("--duration");
+    if (duration <= 0) {
+      std::cerr << "duration must be at least 1 s\n";
+      return -1;
+    }
+    options.duration_ns = uint64_t(duration) * 1000000000;
+  }
+  const int flush_ms = watch_command.get<int>("--flush-ms");
+  if (flush_ms < 0) {
+    std::cerr << "flush interval must not be negative\n";
+    return -1;
+  }
+  options.flush_interval_ns = uint64_t(flush_ms) * 1000000;
+  options.changes_only = watch_command.get<bool>("--changes-only");
+  const auto method = watch_command.get<std::string>("--method");
+  if ("sysfs" != method && "lseek" != method) {
+    std::cerr << "unknown method " << method << ", use sysfs or lseek\n";
+    return -1;
+  }
+
+  // before any thread is started
+  const TerminationSignals signals;
+  // a closed pipe ends the output instead of the process
+  signal(SIGPIPE, SIG_IGN);
+
+  try {
+    options.format = parseWatchFormat(watch_command.get<std::string>("--format"));
+
+    std::vector<ServedSensor> sensors;
+    for (const auto& path :
+         watch_command.get<std::vector<std::string>>("SENSOR")) {
+      sensors.push_back({.path = path,
+                         .rate_hz = options.rate_hz,
+                         .method = {},
+                         .read = {}});
+      if ("sysfs" == method) {
+        attachServeReader<ReaderSysfs>(sensors.back());
+      } else {
+        attachServeReader<ReaderLseek>(sensors.back());
+      }
+    }
+
+    const auto summary = watch(sensors, options, STDOUT_FILENO,
+                               signals.set(), std::cerr);
+
+    std::cerr << "watched " << sensors.size() << " sensor(s) for "
+              << summary.usage.wall_s << " s: " << summary.samples
+              << " samples, " << summary.lines << " lines, "
+              << summary.writes << " writes\n"
+              << "        Access Time:       mean " << summary.access_mean_ns
+              << " ns, max " << summary.access_max_ns << " ns\n"
+              << "        Missed Deadlines:  " << summary.missed << "\n"
+              << "        Read Errors:       " << summary.errors << "\n"
+              << "        CPU Utilization:   "
+              << (summary.usage.wall_s > 0
+                      ? summary.usage.cpu_s / summary.usage.wall_s * 100
+                      : 0)
+              << " %\n"
+              << "        Peak RSS:          "
+              << summary.usage.peak_rss_kib / 1024.0 << " MiB\n";
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return -1;
+  }
+
+  return 0;
+}
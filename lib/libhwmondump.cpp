@@ -0,0 +1,223 @@
+//
+// libhwmondump: C API of the hwmondump readers, see hwmondump.h
+//
+
+#include <hwmondump.h>
+
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include <contention.hpp>
+#include <fixed_rate.hpp>
+#include <hwmondump_util.hpp>
+#include <plugin_reader.hpp>
+
+// C samples are used as time_reading_storage elements without copying, see
+// plugin_reader.hpp
+using sample_span = std::span<time_reading_storage::value_type>;
+
+/**
+ * any reader behind the C API
+ */
+struct hwmondump_reader {
+  virtual ~hwmondump_reader() = default;
+  virtual const char* method() const = 0;
+  virtual double getvalue() = 0;
+  virtual void sample(sample_span samples) = 0;
+  virtual void sampleRate(sample_span samples, FixedRateSchedule& schedule) = 0;
+};
+
+namespace {
+
+thread_local std::string last_error;
+
+/**
+ * keeps the reader R behind the C API, with the same sampling loop as
+ * hwmondump record
+ *
+ * Most readers only fail when reading, so the sensor is read once on
+ * construction: a sensor which can not be read fails to open.
+ */
+template <Reader R>
+class ApiReader : public hwmondump_reader {
+ private:
+  std::string method_;
+  R reader_;
+
+ public:
+  ApiReader(const std::string& sensor, const ReaderOptions& options = {})
+      : method_(readerMethod<R>(options)),
+        reader_(makeReader<R>(sensor, options)) {
+    reader_.getvalue();
+  }
+
+  const char* method() const override { return method_.c_str(); }
+
+  double getvalue() override { return reader_.getvalue(); }
+
+  void sample(sample_span samples) override { takeSamples(reader_, samples); }
+
+  void sampleRate(sample_span samples, FixedRateSchedule& schedule) override {
+    schedule.run(samples.size(), [&](int i) {
+      samples[i] = {gettimestampnano(), reader_.getvalue()};
+    });
+  }
+};
+
+// plugins stay loaded until the library is unloaded
+std::mutex plugin_mutex;
+std::list<PluginLibrary> plugin_libraries;
+
+/**
+ * @throws std::runtime_error if method is unknown or sensor can not be opened
+ */
+hwmondump_reader* openReader(const std::string& method,
+                             const std::string& sensor) {
+  if ("sysfs" == method) {
+    return new ApiReader<ReaderSysfs>(sensor);
+  } else if ("lseek" == method) {
+    return new ApiReader<ReaderLseek>(sensor);
+  } else if ("libsensors" == method) {
+    return new ApiReader<ReaderLibsens>(sensor);
+  } else if ("poll" == method) {
+    return new ApiReader<ReaderPoll>(sensor);
+  } else if ("null" == method) {
+    return new ApiReader<ReaderNull>(sensor);
+  }
+
+  ReaderOptions options;
+  {
+    // guards plugin_libraries only, the plugin itself stays loaded
+    std::lock_guard lock(plugin_mutex);
+    options.plugin =
+        &findPlugin(method, plugin_libraries, pluginSearchPath()).plugin();
+  }
+  return new ApiReader<ReaderPlugin>(sensor, options);
+}
+
+/**
+ * runs f, translating exceptions into -1 and last_error
+ */
+template <typename F>
+int guarded(F&& f) {
+  try {
+    f();
+    return 0;
+  } catch (const std::exception& e) {
+    last_error = e.what();
+    return -1;
+  }
+}
+
+void requireReader(const hwmondump_reader* reader) {
+  if (nullptr == reader) {
+    throw std::invalid_argument("reader is NULL");
+  }
+}
+
+sample_span asSpan(struct hwmondump_sample* samples, size_t count) {
+  if (nullptr == samples && count > 0) {
+    throw std::invalid_argument("samples is NULL");
+  }
+  return {reinterpret_cast<time_reading_storage::value_type*>(samples), count};
+}
+
+}  // namespace
+
+extern "C" {
+
+unsigned hwmondump_api_version(void) {
+  return HWMONDUMP_API_VERSION;
+}
+
+const char* hwmondump_last_error(void) {
+  return last_error.c_str();
+}
+
+uint64_t hwmondump_timestamp_ns(void) {
+  return gettimestampnano();
+}
+
+hwmondump_reader* hwmondump_reader_open(const char* method,
+                                        const char* sensor) {
+  hwmondump_reader* reader = nullptr;
+  guarded([&] {
+    if (nullptr == method || nullptr == sensor) {
+      throw std::invalid_argument("method and sensor are required");
+    }
+    reader = openReader(method, sensor);
+  });
+  return reader;
+}
+
+void hwmondump_reader_close(hwmondump_reader* reader) {
+  delete reader;
+}
+
+const char* hwmondump_reader_method(const hwmondump_reader* reader) {
+  return reader ? reader->method() : nullptr;
+}
+
+int hwmondump_read(hwmondump_reader* reader, double* value) {
+  return guarded([&] {
+    requireReader(reader);
+    if (nullptr == value) {
+      throw std::invalid_argument("value is NULL");
+    }
+    *value = reader->getvalue();
+  });
+}
+
+int hwmondump_read_batch(hwmondump_reader* reader,
+                         struct hwmondump_sample* samples,
+                         size_t count) {
+  return guarded([&] {
+    requireReader(reader);
+    reader->sample(asSpan(samples, count));
+  });
+}
+
+int hwmondump_read_batch_rate(hwmondump_reader* reader,
+                              struct hwmondump_sample* samples,
+                              size_t count,
+                              uint32_t rate_hz) {
+  return guarded([&] {
+    requireReader(reader);
+    if (0 == rate_hz || rate_hz > 1000000) {
+      throw std::invalid_argument("rate must be between 1 Hz and 1 MHz");
+    }
+    FixedRateSchedule schedule(rate_hz, 0);
+    reader->sampleRate(asSpan(samples, count), schedule);
+  });
+}
+
+int hwmondump_compute_stats(const struct hwmondump_sample* samples,
+                            size_t count,
+                            struct hwmondump_stats* stats) {
+  return guarded([&] {
+    if (nullptr == stats) {
+      throw std::invalid_argument("stats is NULL");
+    }
+    auto span = asSpan(const_cast<struct hwmondump_sample*>(samples), count);
+    const time_reading_storage storage(span.begin(), span.end());
+
+    const auto latencies = accessLatencies(storage);
+    const auto updates = valueUpdates(storage);
+    *stats = {
+        .samples = count,
+        .access_median_ns = latencies.median_ns,
+        .access_p99_ns = latencies.p99_ns,
+        .access_max_ns = latencies.max_ns,
+        .access_mean_ns = latencies.mean_ns,
+        .changes = updates.changes,
+        .update_interval_median_ns = updates.median_interval_ns,
+    };
+  });
+}
+
+}  // extern "C"
@@ -0,0 +1,73 @@
+/*
+ * Example reader plugin: keeps the file open and reads it with a single
+ * pread() per sample, i.e. without the lseek() of --sysfs-lseek.
+ *
+ *   hwmondump record --method pread /sys/class/hwmon/hwmon0/temp1_input
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <hwmondump_plugin.h>
+
+struct pread_state {
+  int fd;
+};
+
+static void* pread_open(const char* sensor, const char** error) {
+  struct pread_state* state = malloc(sizeof(*state));
+  if (NULL == state) {
+    *error = "out of memory";
+    return NULL;
+  }
+
+  state->fd = open(sensor, O_RDONLY);
+  if (state->fd < 0) {
+    free(state);
+    *error = "could not open sensor file, does it exist?";
+    return NULL;
+  }
+  return state;
+}
+
+static int pread_read_batch(void* opaque,
+                            struct hwmondump_sample* samples,
+                            size_t count,
+                            hwmondump_timestamp_fn timestamp,
+                            const char** error) {
+  const int fd = ((struct pread_state*)opaque)->fd;
+  char content[64];
+
+  for (size_t i = 0; i < count; ++i) {
+    samples[i].timestamp_ns = timestamp();
+    ssize_t bytes = pread(fd, content, sizeof(content) - 1, 0);
+    if (bytes <= 0) {
+      *error = "file empty";
+      return -1;
+    }
+    content[bytes] = 0;
+    samples[i].value = atof(content);
+  }
+  return 0;
+}
+
+static void pread_close(void* opaque) {
+  struct pread_state* state = opaque;
+  close(state->fd);
+  free(state);
+}
+
+static const struct hwmondump_plugin pread_plugin = {
+    .abi_version = HWMONDUMP_PLUGIN_ABI_VERSION,
+    .name = "pread",
+    .open = pread_open,
+    .read_batch = pread_read_batch,
+    .close = pread_close,
+};
+
+const struct hwmondump_plugin* hwmondump_plugin_entry(void) {
+  return &pread_plugin;
+}
@@ -1,6 +1,9 @@
 #include <config.h>
 #include <algorithm>
 #include <analysis_util.hpp>
+#include <decimation_util.hpp>
+#include <staleness.hpp>
+#include <system_counters.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_all.hpp>
 #include <fstream>
@@ -157,3 +160,125 @@ TEST_CASE("simple csv output") {
   ReadingsDirectory rd(TEST_SOURCE_DIR "/full_run/");
   REQUIRE(rd.csv() == "/sys/class/hwmon/hwmon5/temp1_input,8eb5bfce-ed49-4542-b1e6-0e60fe172ce4,5019.000000,NA,6202.000000,NA");
 }
+
+TEST_CASE("decimation") {
+  // 1000 timestamps with a single spike in the value
+  std::ofstream mockCSV(TEST_BINARY_DIR "/decimate_timestamp_value.csv");
+  mockCSV << "nanoseconds,value\n";
+  for (uint64_t i = 0; i < 1000; ++i) {
+    mockCSV << 1000 + i * 10 << "," << (i == 567 ? 99 : i % 3) << "\n";
+  }
+  mockCSV.close();
+
+  SECTION("count rows") {
+    REQUIRE(countCsvRows(TEST_BINARY_DIR "/decimate_timestamp_value.csv") ==
+            1000);
+  }
+
+  SECTION("lttb") {
+    auto decimated = decimateFile(
+        TEST_BINARY_DIR "/decimate_timestamp_value.csv", 50, "lttb");
+
+    REQUIRE(decimated.size() == 50);
+    REQUIRE(decimated.front().first == 1000);
+    REQUIRE(decimated.back().first == 1000 + 999 * 10);
+    REQUIRE(std::is_sorted(decimated.begin(), decimated.end()));
+    REQUIRE(std::any_of(decimated.begin(), decimated.end(),
+                        [](const auto& s) { return s.second == 99; }));
+  }
+
+  SECTION("minmax") {
+    auto decimated = decimateFile(
+        TEST_BINARY_DIR "/decimate_timestamp_value.csv", 50, "minmax");
+
+    REQUIRE(decimated.size() <= 50);
+    REQUIRE(decimated.front().first == 1000);
+    REQUIRE(decimated.back().first == 1000 + 999 * 10);
+    REQUIRE(std::is_sorted(decimated.begin(), decimated.end()));
+    REQUIRE(std::any_of(decimated.begin(), decimated.end(),
+                        [](const auto& s) { return s.second == 99; }));
+  }
+
+  SECTION("fewer rows than points") {
+    WriteMockCSV({2, 6, 12});
+    auto decimated =
+        decimateFile(TEST_BINARY_DIR "/test_timestamp_value.csv", 50, "lttb");
+    REQUIRE(decimated.size() == 3);
+  }
+
+  SECTION("unknown method") {
+    REQUIRE_THROWS(decimateFile(
+        TEST_BINARY_DIR "/decimate_timestamp_value.csv", 50, "nope"));
+  }
+}
+
+TEST_CASE("largest gaps") {
+  WriteMockCSV({2, 6, 12, 34, 54, 55});
+
+  auto gaps = findLargestGaps(TEST_BINARY_DIR "/test_timestamp_value.csv", 2);
+  REQUIRE(gaps.size() == 2);
+  REQUIRE(gaps[0].start == 12);
+  REQUIRE(gaps[0].length == 22);
+  REQUIRE(gaps[1].start == 34);
+  REQUIRE(gaps[1].length == 20);
+
+  SECTION("counters around gap") {
+    std::vector<SystemCounters> samples = {
+        {.timestamp = 0, .interrupts = 1},
+        {.timestamp = 10, .interrupts = 3},
+        {.timestamp = 40, .interrupts = 8},
+        {.timestamp = 60, .interrupts = 20},
+    };
+
+    auto delta = countersAroundGap(samples, gaps[0]);
+    REQUIRE(delta);
+    REQUIRE(delta->timestamp == 30);
+    REQUIRE(delta->interrupts == 5);
+
+    // not covered by samples
+    REQUIRE(!countersAroundGap(samples, {.start = 50, .length = 20}));
+    REQUIRE(!countersAroundGap({}, gaps[0]));
+  }
+}
+
+TEST_CASE("staleness") {
+  SECTION("value changes") {
+    const std::string fname(TEST_BINARY_DIR "/staleness_timestamp_value.csv");
+    std::ofstream csv(fname);
+    csv << "nanoseconds,value\n10,1\n20,1\n30,2\n40,2\n50,1\n";
+    csv.close();
+
+    auto changes = loadValueChanges(fname);
+    REQUIRE(changes.size() == 2);
+    REQUIRE(changes[0].timestamp == 30);
+    REQUIRE(changes[0].value == 2);
+    REQUIRE(changes[1].timestamp == 50);
+    std::filesystem::remove(fname);
+  }
+
+  SECTION("methods compared to the first observation") {
+    // updates every 1000 ns, b is always 100 ns late and misses one update,
+    // c is as fast as a, but scaled like libsensors
+    auto summaries = compareStaleness({
+        {"a", {{1000, 1}, {2000, 2}, {3000, 3}, {4000, 4}}},
+        {"b", {{1100, 1}, {2100, 2}, {4100, 4}}},
+        {"c", {{1000, 0.001}, {2000, 0.002}, {3000, 0.003}, {4000, 0.004}}},
+    });
+
+    REQUIRE(summaries.size() == 3);
+    REQUIRE(summaries[0].method == "a");
+    REQUIRE(summaries[0].matched == 3);
+    REQUIRE(summaries[0].first == 3);
+    REQUIRE(summaries[0].max_ns == 0);
+    REQUIRE(summaries[1].method == "b");
+    REQUIRE(summaries[1].changes == 3);
+    REQUIRE(summaries[1].first == 0);
+    REQUIRE(summaries[1].median_ns == 100);
+    REQUIRE(summaries[1].max_ns == 100);
+    REQUIRE(summaries[2].first == 3);
+  }
+
+  SECTION("needs two methods") {
+    REQUIRE_THROWS(compareStaleness({{"a", {{1000, 1}}}}));
+  }
+}
@@ -94,6 +94,34 @@ test -f ./null_timestamp_value.csv
 test -f ./null_duration_value.csv
 delete_output
 
+# system counters
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --null --system-counters-interval 1 -a 100
+test -f ./null_system_counters.csv
+grep -E 'system_counters_interval_ms *= *1' metadata.toml > /dev/null
+"$HWMONDUMP_BIN" analysis --gaps 3
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --null --system-counters-interval 0 -a 100
+rm ./null_system_counters.csv
+delete_output
+
+# fixed rate
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --null --rate 1000 --rate-spin-us 50 -a 100
+test -f ./null_deadlines.csv
+test 101 -eq "$(wc -l < null_deadlines.csv)"
+grep -E 'rate_hz *= *1000' metadata.toml > /dev/null
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --null --rate 0 -a 100
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --null --rate-spin-us 50 -a 100
+rm ./null_deadlines.csv
+delete_output
+
+# background load
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --null --load spin:0 --load syscall:0 -a 1000
+grep -E 'kind *= *.spin' metadata.toml > /dev/null
+grep -E 'kind *= *.syscall' metadata.toml > /dev/null
+grep 'rate_per_s' metadata.toml > /dev/null
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --null --load disk:0 -a 100
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --null --load spin:0- -a 100
+delete_output
+
 # directory for output
 mkdir "$DIR"/o/
 
@@ -221,6 +249,14 @@ echo 15,42 >> ./mock2_timestamp_value.csv
 "$HWMONDUMP_BIN" analysis --median -d ./
 "$HWMONDUMP_BIN" analysis --median --directory ./
 
+# decimation writes one file per input, never overwrites
+"$HWMONDUMP_BIN" analysis --decimate 10
+test -f ./mock1_timestamp_value_decimated.csv
+test -f ./mock2_timestamp_value_decimated.csv
+! "$HWMONDUMP_BIN" analysis --decimate 10
+! "$HWMONDUMP_BIN" analysis --decimate 2 --decimate-method minmax
+rm ./mock1_timestamp_value_decimated.csv ./mock2_timestamp_value_decimated.csv
+
 # create new directory
 test '!' -d newdir
 "$HWMONDUMP_BIN" record "$TEST_SENSOR" --null -o ./newdir/here/ -a 100
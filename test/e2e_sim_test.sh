@@ -0,0 +1,235 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+#
+# runs the file based methods against a simulated hwmon tree,
+# works without sensors
+#
+
+# finds all output files and deletes them
+function delete_output () {
+    find $DIR -name '*_timestamp_value.csv' -delete -o -name '*_duration_value.csv' -delete -o -name 'metadata.toml' -delete
+}
+
+# get hwmondump binary from console input
+HWMONDUMP_BIN=$1
+# optional: directory of the example plugin
+PLUGIN_DIR=${2:-}
+
+test -f $HWMONDUMP_BIN -a -x $HWMONDUMP_BIN || (echo "hwmondump binary not found at: $HWMONDUMP_BIN" >&2 && exit 127)
+
+# make temp dir, prefer tmpfs
+DIR=$(mktemp -d -p /dev/shm 2>/dev/null || mktemp -d)
+SIM_PID=""
+
+# stop simulator and delete said temp dir on close
+function cleanup()
+{
+    echo "exit code:    " $?
+    test -n "$SIM_PID" && kill "$SIM_PID" && wait "$SIM_PID" || true
+    rm -r $DIR
+}
+trap cleanup EXIT SIGINT SIGTERM
+
+# go to temp dir for simpler tests
+cd $DIR
+
+# invalid arguments
+! "$HWMONDUMP_BIN" simulate "$DIR/sim" --chips 0
+! "$HWMONDUMP_BIN" simulate "$DIR/sim" --pattern zigzag --duration 1
+! "$HWMONDUMP_BIN" list --hwmon-root "$DIR/doesnotexist"
+
+"$HWMONDUMP_BIN" simulate "$DIR/sim" --chips 2 --interval-us 1000 --duration 60 > sim_list.txt &
+SIM_PID=$!
+
+# wait for tree
+for i in $(seq 50); do
+    test -f "$DIR/sim/hwmon1/energy1_input" && break
+    sleep 0.1
+done
+
+# list sees the same attributes as reported by the simulator
+"$HWMONDUMP_BIN" list --hwmon-root "$DIR/sim" > list.txt
+diff sim_list.txt list.txt
+test 13 -eq "$(wc -l < list.txt)"
+
+# values and types as extra columns
+"$HWMONDUMP_BIN" list --hwmon-root "$DIR/sim" --values --types > list_values.txt
+test "full_path;chip_path;subfeature;feature;value;type;unit" = "$(head -n1 list_values.txt)"
+grep -E '/hwmon0/temp1_input;.*;temp1;[0-9]+;temp;millidegree Celsius$' list_values.txt > /dev/null
+diff <(cut -d ";" -f 1-4 list_values.txt) list.txt
+
+TEST_SENSOR=$(grep temp1_input list.txt | head -n1 | cut -d ";" -f 1)
+test -f "$TEST_SENSOR"
+
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs --sysfs-lseek -a 100000
+test -f ./metadata.toml
+test -f ./sysfs_timestamp_value.csv
+test -f ./lseek_timestamp_value.csv
+
+# values change, so durations must be recorded
+test 1 -lt "$(wc -l < sysfs_duration_value.csv)"
+test 1 -lt "$(wc -l < lseek_duration_value.csv)"
+
+"$HWMONDUMP_BIN" analysis --median
+
+# adaptive polling locks onto the 1 ms updates
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs-lseek --adaptive -t 1 -o ./adaptive/
+grep -E '^\[adaptive.lseek\]|lseek *= *\{' ./adaptive/metadata.toml > /dev/null
+test 1 -lt "$(wc -l < ./adaptive/lseek_duration_value.csv)"
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs-lseek --adaptive --rate 100 -t 1 -o ./adaptive/invalid/
+rm -r adaptive
+
+# replay the recording, values are identical
+mkdir replay
+# (warmup consumes the first 10% of the recording)
+"$HWMONDUMP_BIN" record ./lseek_timestamp_value.csv --replay -a 50000 -o ./replay/
+test -f ./replay/replay_timestamp_value.csv
+test 1 -lt "$(wc -l < ./replay/replay_duration_value.csv)"
+diff <(cut -d, -f2 lseek_timestamp_value.csv | sed -n 5002,55001p) <(cut -d, -f2 ./replay/replay_timestamp_value.csv | sed -n 2,50001p)
+"$HWMONDUMP_BIN" record ./lseek_timestamp_value.csv --replay --replay-timing -a 1000 -o ./replay/timed/
+! "$HWMONDUMP_BIN" record ./doesnotexist.csv --replay -a 100 -o ./replay/missing/
+rm -r replay
+
+# concurrent readers, one set of files per thread
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs-lseek --threads 2 -a 10000 -o ./threads/
+test -f ./threads/lseek-t0_timestamp_value.csv
+test -f ./threads/lseek-t1_timestamp_value.csv
+test 10001 -eq "$(wc -l < ./threads/lseek-t1_timestamp_value.csv)"
+grep -E '^threads *= *2' ./threads/metadata.toml > /dev/null
+"$HWMONDUMP_BIN" analysis --median -d ./threads/ | grep lseek-t1
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs-lseek --threads 2 --rate 100 -a 100 -o ./threads/invalid/
+rm -r threads
+
+# concurrent methods share one timeline
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs --sysfs-lseek --concurrent -a 100000 -o ./concurrent/
+test -f ./concurrent/sysfs_timestamp_value.csv
+test -f ./concurrent/lseek_timestamp_value.csv
+grep -E '^\[concurrent_cpus\]|concurrent_cpus *= *\{' ./concurrent/metadata.toml > /dev/null
+"$HWMONDUMP_BIN" analysis --staleness -d ./concurrent/ | grep 'lseek: first in'
+test 2 -eq "$("$HWMONDUMP_BIN" analysis --staleness --csv -d ./concurrent/ | wc -l)"
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs --concurrent --threads 2 -a 100 -o ./concurrent/invalid/
+rm -r concurrent
+
+# snapshots of a whole chip, one column per attribute
+"$HWMONDUMP_BIN" record "$DIR/sim/hwmon1" --group 'temp*_input,energy*_input' -a 1000 -o ./group/
+test "nanoseconds,energy1_input,temp1_input,temp2_input" = "$(head -n1 ./group/group_snapshots.csv)"
+test 1001 -eq "$(wc -l < ./group/group_snapshots.csv)"
+grep group_attributes ./group/metadata.toml > /dev/null
+! "$HWMONDUMP_BIN" record "$DIR/sim/hwmon1" --group 'nomatch*' -a 100 -o ./group/invalid/
+! "$HWMONDUMP_BIN" record "$DIR/sim/hwmon1" --group 'temp*' --sysfs -a 100 -o ./group/invalid2/
+rm -r group
+
+# power derived from the energy counter
+"$HWMONDUMP_BIN" record "$DIR/sim/hwmon1/energy1_input" --sysfs-lseek --derive -a 100000 -o ./derived/
+test "nanoseconds,power_w" = "$(head -n1 ./derived/lseek_derived.csv)"
+test 2 -lt "$(wc -l < ./derived/lseek_derived.csv)"
+grep -E '^\[derived.lseek\]|lseek *= *\{' ./derived/metadata.toml > /dev/null
+! "$HWMONDUMP_BIN" record "$DIR/sim/hwmon1/energy1_input" --sysfs-lseek --derive-wrap 0 -a 100 -o ./derived/invalid/
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs-lseek --derive-wrap 100 -a 100 -o ./derived/invalid/
+rm -r derived
+
+# histograms and summary only, no per-sample files
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs-lseek --summary-only -a 100000 -o ./summary/
+test '!' -e ./summary/lseek_timestamp_value.csv
+test '!' -e ./summary/lseek_duration_value.csv
+test "histogram,lower_ns,upper_ns,count" = "$(head -n1 ./summary/lseek_histogram.csv)"
+grep -E '^value_duration,' ./summary/lseek_histogram.csv > /dev/null
+grep -E '^samples *= *100000' ./summary/metadata.toml > /dev/null
+grep -E '^changes *= *[1-9]' ./summary/metadata.toml > /dev/null
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs --summary-only -t 1 -o ./summary/timed/
+grep -E '^access_p99_ns *= *[1-9]' ./summary/timed/metadata.toml > /dev/null
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs --summary-only --rate 100 -a 100 -o ./summary/invalid/
+rm -r summary
+
+# cost map of all simulated sensors, one row per sensor and method
+"$HWMONDUMP_BIN" survey --hwmon-root "$DIR/sim" --budget-ms 5 --jobs 2 > survey.csv
+test 25 -eq "$(wc -l < survey.csv)"
+grep -E '/hwmon1/temp1_input,lseek,[0-9]+,[1-9][0-9]*,' survey.csv > /dev/null
+"$HWMONDUMP_BIN" survey --hwmon-root "$DIR/sim" --attributes 'temp1_input' --sysfs --budget-ms 5 > survey.csv
+test 3 -eq "$(wc -l < survey.csv)"
+! "$HWMONDUMP_BIN" survey --hwmon-root "$DIR/sim" --attributes 'nomatch*'
+! "$HWMONDUMP_BIN" survey --hwmon-root "$DIR/sim" --budget-ms 0
+rm survey.csv
+
+# plugin methods are recorded like built-in ones
+if test -n "$PLUGIN_DIR"; then
+    HWMONDUMP_PLUGIN_PATH="$PLUGIN_DIR" "$HWMONDUMP_BIN" record "$TEST_SENSOR" --method pread -a 10000 -o ./plugin/
+    test 10001 -eq "$(wc -l < ./plugin/pread_timestamp_value.csv)"
+    test 1 -lt "$(wc -l < ./plugin/pread_duration_value.csv)"
+    grep -E '^\[plugins\]|plugins *= *\{' ./plugin/metadata.toml > /dev/null
+    "$HWMONDUMP_BIN" record "$TEST_SENSOR" --plugin "$PLUGIN_DIR/hwmondump_pread.so" --method pread --threads 2 -a 1000 -o ./plugin/threads/
+    test -f ./plugin/threads/pread-t1_timestamp_value.csv
+    HWMONDUMP_PLUGIN_PATH="$PLUGIN_DIR" "$HWMONDUMP_BIN" record "$TEST_SENSOR" --method pread --sysfs --concurrent -a 1000 -o ./plugin/concurrent/
+    test -f ./plugin/concurrent/pread_timestamp_value.csv
+    test -f ./plugin/concurrent/sysfs_timestamp_value.csv
+    rm -r plugin
+fi
+! HWMONDUMP_PLUGIN_PATH="$DIR" "$HWMONDUMP_BIN" record "$TEST_SENSOR" --method missing -a 100 -o ./plugin/invalid/
+
+# the simulator never notifies, so every poll wakes by timeout
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --poll --poll-timeout-ms 2 -a 100 -o ./poll/
+grep -E '^poll_timeout_ms *= *2' ./poll/metadata.toml > /dev/null
+grep -E '^notifications *= *0' ./poll/metadata.toml > /dev/null
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --poll --poll-timeout-ms 0 -a 100 -o ./poll/invalid/
+rm -r poll
+
+# live samples of a running recording through shared memory
+SHM_NAME="hwmondump_e2e_$$"
+"$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs-lseek --rate 1000 -a 2000 --shm "$SHM_NAME" -o ./shm/ > /dev/null &
+RECORD_PID=$!
+while test '!' -e "/dev/shm/$SHM_NAME"; do sleep 0.05; done
+"$HWMONDUMP_BIN" subscribe "$SHM_NAME" --count 10 > shm_head.csv
+"$HWMONDUMP_BIN" subscribe "$SHM_NAME" --from-oldest > shm_all.csv
+wait "$RECORD_PID"
+test 11 -eq "$(wc -l < shm_head.csv)"
+grep -E '^[0-9]+,[0-9]+,[0-9.]+$' shm_all.csv > /dev/null
+# every sample of the recording was published, warmup included
+tail -n 1 ./shm/lseek_timestamp_value.csv | cut -d , -f 2 > shm_last.txt
+tail -n 1 shm_all.csv | cut -d , -f 3 | cmp - shm_last.txt
+grep -E "^shm_ring *= *\"/$SHM_NAME\"" ./shm/metadata.toml > /dev/null
+test '!' -e "/dev/shm/$SHM_NAME"
+! "$HWMONDUMP_BIN" subscribe "$SHM_NAME"
+! "$HWMONDUMP_BIN" record "$TEST_SENSOR" --sysfs --null -a 100 --shm "$SHM_NAME" -o ./shm/invalid/
+rm -r shm shm_head.csv shm_all.csv shm_last.txt
+
+# many clients share one cached reader per sensor
+"$HWMONDUMP_BIN" serve ./serve.sock --attributes 'temp*_input' --hwmon-root "$DIR/sim" --sensor "$TEST_SENSOR@100" --duration 3 > serve_sensors.txt &
+SERVE_PID=$!
+while test '!' -S ./serve.sock; do sleep 0.05; done
+"$HWMONDUMP_BIN" query ./serve.sock > serve_all.txt
+test 4 -eq "$(wc -l < serve_all.txt)"
+grep -E '/hwmon1/temp2_input [0-9.]+ [0-9]+ [0-9]+$' serve_all.txt > /dev/null
+QUERY_PIDS=""
+for i in 1 2 3 4 5 6 7 8; do
+    "$HWMONDUMP_BIN" query ./serve.sock "$TEST_SENSOR" > /dev/null &
+    QUERY_PIDS="$QUERY_PIDS $!"
+done
+for pid in $QUERY_PIDS; do wait "$pid"; done
+"$HWMONDUMP_BIN" query ./serve.sock --list | grep -E "^$TEST_SENSOR (sysfs|lseek) 100 " > /dev/null
+! "$HWMONDUMP_BIN" query ./serve.sock "$DIR/sim/hwmon0/fan1_input"
+wait "$SERVE_PID"
+test '!' -e ./serve.sock
+! "$HWMONDUMP_BIN" query ./serve.sock
+! "$HWMONDUMP_BIN" serve ./serve.sock --sensor "$TEST_SENSOR@0" --duration 1
+! "$HWMONDUMP_BIN" serve ./serve.sock --duration 1
+rm serve_sensors.txt serve_all.txt
+
+# live values, the simulated sensors change every ms
+"$HWMONDUMP_BIN" watch "$TEST_SENSOR" "$DIR/sim/hwmon1/fan1_input" --rate 100 --count 20 2> watch_overhead.txt > watch.csv
+test 41 -eq "$(wc -l < watch.csv)"
+grep -E '/hwmon1/fan1_input,[0-9]+,[0-9.]+$' watch.csv > /dev/null
+grep 'CPU Utilization' watch_overhead.txt > /dev/null
+"$HWMONDUMP_BIN" watch "$TEST_SENSOR" --rate 1000 --format json --changes-only --duration 1 | head -n 5 > watch.json
+test 5 -eq "$(grep -c '^{"sensor":".*","timestamp_ns":[0-9]*,"value":[0-9.]*}$' watch.json)"
+! "$HWMONDUMP_BIN" watch "$TEST_SENSOR" --format xml --count 1
+rm watch.csv watch.json watch_overhead.txt
+delete_output
+
+# simulator removes its tree on exit
+kill "$SIM_PID"
+wait "$SIM_PID"
+SIM_PID=""
+test '!' -d "$DIR/sim/hwmon0"
+
+# note: cleanup by trap
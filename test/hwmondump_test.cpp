@@ -6,8 +6,13 @@
 #include <sstream>
 #include <iostream>
 #include <hwmondump_util.hpp>
+#include <hwmon_simulator.hpp>
 #include <type_traits>
 #include <metadata.hpp>
+#include <serve.hpp>
+#include <survey.hpp>
+#include <watch.hpp>
+#include <hwmondump.h>
 #include <ctime>
 
 TEST_CASE("reading takes over 1 second") {
@@ -66,6 +71,51 @@ TEST_CASE("Lseek class start to finish") {
   }
 }
 
+TEST_CASE("Poll class start to finish") {
+  ReaderOptions options;
+  options.poll_timeout_ms = 1;
+
+  SECTION("regular files never notify") {
+    ReaderPoll reader(TEST_SOURCE_DIR "/test_file.txt", options);
+
+    REQUIRE(reader.getvalue() == 42);
+    REQUIRE(reader.getvalue() == 42);
+
+    auto stats = reader.stats();
+    REQUIRE(stats["notifications"] == 0);
+    REQUIRE(stats["timeouts"] == 2);
+  }
+
+  SECTION("stats of the measurement") {
+    time_reading_storage storage(10);
+    std::map<std::string, double> reader_stats;
+    MeasurementHooks hooks;
+    hooks.reader_stats = &reader_stats;
+    runbench<ReaderPoll>(10, TEST_SOURCE_DIR "/test_file.txt", storage, hooks,
+                         nullptr, options);
+
+    // warmup not included
+    REQUIRE(reader_stats["timeouts"] == 10);
+    REQUIRE(reader_stats["notifications"] == 0);
+  }
+
+  SECTION("file errors") {
+    ReaderPoll reader(TEST_SOURCE_DIR "/test_file2.txt", options);
+
+    REQUIRE_THROWS(reader.getvalue());
+
+    ReaderPoll reader2("./wrong_path.txt", options);
+
+    REQUIRE_THROWS(reader2.getvalue());
+
+    // opens, but the initial read fails
+    ReaderPoll reader3(TEST_SOURCE_DIR, options);
+
+    REQUIRE_THROWS_WITH(reader3.getvalue(),
+                        "[poll] could not read sensor: Is a directory");
+  }
+}
+
 TEST_CASE("benchmarkNum func") {
   time_reading_storage storageHw;
   storageHw.resize(1);
@@ -81,6 +131,42 @@ TEST_CASE("benchmarkNum func") {
   REQUIRE(storageLs[0].second == 42);
 }
 
+TEST_CASE("batch readers") {
+  static_assert(BatchReader<ReaderSysfs>);
+  static_assert(BatchReader<ReaderLseek>);
+  static_assert(BatchReader<ReaderNull>);
+  static_assert(!BatchReader<ReaderLibsens>);
+  static_assert(!BatchReader<ReaderPoll>);
+
+  SECTION("same samples as getvalue") {
+    time_reading_storage storage(100);
+    ReaderLseek reader(TEST_SOURCE_DIR "/test_file.txt");
+    reader.getbatch(storage);
+    for (const auto& sample : storage) {
+      REQUIRE(sample.second == 42);
+    }
+    REQUIRE(std::is_sorted(storage.begin(), storage.end()));
+    REQUIRE(storage.front().first > 0);
+    REQUIRE(reader.getvalue() == 42);
+  }
+
+  SECTION("benchmarkNum fills only accessnum samples") {
+    time_reading_storage storage(10, {0, -1});
+    benchmarkNum<ReaderSysfs>(5, TEST_SOURCE_DIR "/test_file.txt", storage);
+    REQUIRE(storage[4].second == 42);
+    REQUIRE(storage[4].first > 0);
+    REQUIRE(storage[5].second == -1);
+  }
+
+  SECTION("errors") {
+    time_reading_storage storage(10);
+    ReaderLseek lseek_reader("/does/not/exist");
+    REQUIRE_THROWS(lseek_reader.getbatch(storage));
+    ReaderSysfs sysfs_reader("/does/not/exist");
+    REQUIRE_THROWS(sysfs_reader.getbatch(storage));
+  }
+}
+
 TEST_CASE("benchmarkSec func") {
   REQUIRE(benchmarkSec<ReaderSysfs>(TEST_SOURCE_DIR "/test_file.txt") != 0);
   REQUIRE(benchmarkSec<ReaderLseek>(TEST_SOURCE_DIR "/test_file.txt") != 0);
@@ -323,3 +409,1155 @@ TEST_CASE("metadata") {
     REQUIRE(!std::filesystem::exists(fname));
   }
 }
+
+TEST_CASE("system counters") {
+  SECTION("parse proc table") {
+    std::string content =
+        "           CPU0       CPU1       CPU3\n"
+        "  0:         10          0          5   IO-APIC   2-edge      timer\n"
+        "LOC:        100        200        300   Local timer interrupts\n"
+        "ERR:          7\n";
+    uint64_t total, on_cpu;
+
+    sumProcCpuTable(content, 3, total, on_cpu);
+    REQUIRE(total == 10 + 5 + 100 + 200 + 300 + 7);
+    REQUIRE(on_cpu == 5 + 300);
+
+    // CPU2 is offline and thus not part of the table
+    sumProcCpuTable(content, 2, total, on_cpu);
+    REQUIRE(on_cpu == 0);
+  }
+
+  SECTION("snapshot") {
+    auto counters = takeSystemCounters(0);
+    REQUIRE(counters.timestamp != 0);
+    REQUIRE(counters.interrupts != 0);
+  }
+
+  SECTION("sampler with side thread") {
+    SystemCounterSampler sampler(5);
+    sampler.start();
+    REQUIRE(usleep(50000) == 0);
+    sampler.stop();
+
+    // before, after and some in between
+    REQUIRE(sampler.samples().size() > 2);
+    REQUIRE(std::is_sorted(sampler.samples().begin(), sampler.samples().end(),
+                           [](const auto& a, const auto& b) {
+                             return a.timestamp < b.timestamp;
+                           }));
+    REQUIRE(sampler.total().timestamp >= 50000000);
+  }
+}
+
+TEST_CASE("perf counters") {
+  // counters may be unavailable (VM, container), which must not fail
+  PerfCounters perf;
+  time_reading_storage storage(100);
+  perf.enable();
+  benchmarkNum<ReaderSysfs>(100, TEST_SOURCE_DIR "/test_file.txt", storage);
+  perf.disable();
+
+  auto values = perf.read();
+  if (perf.available()) {
+    for (const auto& [name, value] : values) {
+      REQUIRE(value >= 0);
+    }
+  } else {
+    REQUIRE(values.empty());
+  }
+}
+
+TEST_CASE("phase timer") {
+  SECTION("consecutive phases") {
+    PhaseTimer timer;
+    timer.start("first");
+    REQUIRE(usleep(20000) == 0);
+    timer.start("second");
+    timer.stop();
+    timer.stop();
+
+    REQUIRE(timer.phases().size() == 2);
+    REQUIRE(timer.phases()[0].name == "first");
+    REQUIRE(timer.phases()[0].wall_s >= 0.02);
+    REQUIRE(timer.phases()[1].name == "second");
+    REQUIRE(timer.phases()[1].peak_rss_kib > 0);
+  }
+
+  SECTION("thread clock") {
+    // another thread of the process spins while this one sleeps
+    std::atomic<bool> spinning = true;
+    std::thread spinner([&] {
+      while (spinning) {
+      }
+    });
+    PhaseTimer process_timer;
+    PhaseTimer thread_timer(PhaseClock::thread);
+    process_timer.start("sleep");
+    thread_timer.start("sleep");
+    REQUIRE(usleep(50000) == 0);
+    thread_timer.stop();
+    process_timer.stop();
+    spinning = false;
+    spinner.join();
+
+    REQUIRE(process_timer.phases()[0].cpu_s > 0.02);
+    REQUIRE(thread_timer.phases()[0].cpu_s < 0.01);
+  }
+
+  SECTION("runbench phases") {
+    PhaseTimer timer;
+    MeasurementHooks hooks;
+    hooks.phases = &timer;
+    time_reading_storage storage(10);
+
+    runbench<ReaderSysfs>(10, TEST_SOURCE_DIR "/test_file.txt", storage,
+                          hooks);
+
+    REQUIRE(timer.phases().size() == 3);
+    REQUIRE(timer.phases()[0].name == "sensor_init");
+    REQUIRE(timer.phases()[1].name == "warmup");
+    REQUIRE(timer.phases()[2].name == "measurement");
+  }
+}
+
+TEST_CASE("concurrent readers") {
+  SECTION("every thread fills its storage") {
+    std::vector<time_reading_storage> storages(3, time_reading_storage(100));
+    PhaseTimer phases;
+    runbenchThreads<ReaderLseek>(100, TEST_SOURCE_DIR "/test_file.txt",
+                                 storages, &phases);
+
+    for (const auto& storage : storages) {
+      REQUIRE(storage.size() == 100);
+      for (const auto& [timestamp, value] : storage) {
+        REQUIRE(timestamp > 0);
+        REQUIRE(value == 42);
+      }
+    }
+    REQUIRE(phases.phases().back().name == "measurement");
+  }
+
+  SECTION("errors of a thread are rethrown") {
+    std::vector<time_reading_storage> storages(2, time_reading_storage(10));
+    REQUIRE_THROWS(
+        runbenchThreads<ReaderLseek>(10, "./wrong_path.txt", storages));
+  }
+
+  SECTION("latencies") {
+    auto latency = accessLatencies({{0, 1}, {10, 1}, {30, 1}, {60, 1}});
+    REQUIRE(latency.median_ns == 20);
+    REQUIRE(latency.max_ns == 30);
+    REQUIRE(latency.mean_ns == 20);
+    REQUIRE(accessLatencies({{5, 1}}).max_ns == 0);
+  }
+}
+
+TEST_CASE("background load") {
+  SECTION("cpu lists") {
+    REQUIRE(parseCpuList("3") == std::vector<int>{3});
+    REQUIRE(parseCpuList("0-2,5,2") == std::vector<int>{0, 1, 2, 5});
+    REQUIRE(formatCpuList({0, 1, 2, 5, 7, 8}) == "0-2,5,7-8");
+    REQUIRE_THROWS(parseCpuList(""));
+    REQUIRE_THROWS(parseCpuList("1-"));
+    REQUIRE_THROWS(parseCpuList("3-1"));
+    REQUIRE_THROWS(parseCpuList("1,,2"));
+    REQUIRE_THROWS(parseCpuList("a"));
+  }
+
+  SECTION("specs") {
+    auto spec = LoadSpec::parse("membw:0-1");
+    REQUIRE(spec.kind == LoadKind::membw);
+    REQUIRE(spec.cpus == std::vector<int>{0, 1});
+    REQUIRE_THROWS(LoadSpec::parse("spin"));
+    REQUIRE_THROWS(LoadSpec::parse("disk:0"));
+  }
+
+  SECTION("every kind does work") {
+    int cpu = allowedCpus().front();
+    LoadGenerator load({{LoadKind::spin, {cpu}},
+                        {LoadKind::membw, {cpu}},
+                        {LoadKind::syscall, {cpu}}});
+    load.start();
+    usleep(200000);
+    load.stop();
+
+    auto profile = load.profile();
+    REQUIRE(profile.size() == 3);
+    REQUIRE(profile[1].kind == "membw");
+    REQUIRE(profile[1].cpus == std::to_string(cpu));
+    for (const auto& entry : profile) {
+      REQUIRE(entry.rate > 0);
+    }
+  }
+
+  SECTION("unavailable cpu") {
+    LoadGenerator load({{LoadKind::spin, {CPU_SETSIZE - 1}}});
+    REQUIRE_THROWS(load.start());
+  }
+}
+
+TEST_CASE("fixed rate schedule") {
+  REQUIRE_THROWS(FixedRateSchedule(0, 0));
+
+  SECTION("deadlines") {
+    FixedRateSchedule schedule(1000, 100000);
+    REQUIRE(schedule.period_ns() == 1000000);
+    time_reading_storage storage(50);
+    ReaderNull reader("");
+
+    uint64_t start = gettimestampnano();
+    benchmarkRate(reader, 50, storage, schedule);
+    uint64_t end = gettimestampnano();
+
+    // first access one period after the start, but it may be late
+    REQUIRE(end - start >= 50 * schedule.period_ns());
+    REQUIRE(storage[49].first - storage[0].first >= 48 * schedule.period_ns());
+
+    auto summary = schedule.summary();
+    REQUIRE(summary.median_ns <= summary.p99_ns);
+    REQUIRE(summary.p99_ns <= summary.max_ns);
+
+    const std::string fname(TEST_BINARY_DIR "/null_deadlines.csv");
+    schedule.save(fname);
+    uint64_t previous_target = 0;
+    forEachCsvSample(fname, [&](uint64_t row, const auto& sample) {
+      if (row > 0) {
+        REQUIRE(sample.first - previous_target == schedule.period_ns());
+      }
+      previous_target = sample.first;
+    });
+    REQUIRE(countCsvRows(fname) == 50);
+    std::filesystem::remove(fname);
+  }
+
+  SECTION("missed deadlines are skipped") {
+    FixedRateSchedule schedule(1000, 0);
+    // every access takes more than two periods
+    schedule.run(5, [](int) { usleep(2500); });
+
+    REQUIRE(schedule.summary().missed >= 8);
+  }
+}
+
+TEST_CASE("adaptive polling") {
+  SECTION("constant value never locks") {
+    AdaptivePoller poller;
+    REQUIRE(poller.run(1000, 0, [](int) { return 42.0; }) == 1000);
+    REQUIRE(!poller.locked());
+    REQUIRE(poller.summary().changes == 0);
+  }
+
+  SECTION("time limit") {
+    AdaptivePoller poller;
+    uint64_t start = gettimestampnano();
+    size_t performed =
+        poller.run(SIZE_MAX, 20000000, [](int) { return 42.0; });
+    REQUIRE(performed > 0);
+    REQUIRE(gettimestampnano() - start >= 20000000);
+  }
+
+  SECTION("locks onto simulated sensor") {
+    const std::filesystem::path root(TEST_BINARY_DIR "/adaptive_hwmon");
+    HwmonSimulator simulator(root, 1, std::chrono::milliseconds(5),
+                             SimulationPattern::step);
+    simulator.start();
+    ReaderLseek reader((root / "hwmon0" / "temp1_input").string());
+
+    AdaptivePoller poller;
+    size_t performed = poller.run(SIZE_MAX, 1000000000,
+                                  [&](int) { return reader.getvalue(); });
+
+    REQUIRE(poller.locked());
+    REQUIRE(poller.period_ns() > 4000000);
+    REQUIRE(poller.period_ns() < 6000000);
+    REQUIRE(poller.summary().changes > 100);
+    REQUIRE(poller.summary().polls == performed);
+  }
+}
+
+TEST_CASE("replay reader") {
+  const std::string fname(TEST_BINARY_DIR "/replay_timestamp_value.csv");
+  std::filesystem::remove(fname);
+  // 3 values, 100 ms apart
+  outputstorage({{100000000, 1}, {200000000, 2}, {300000000, 3}}, fname);
+
+  SECTION("values in order, starting over") {
+    ReaderReplay reader(fname);
+    std::vector<double> values;
+    for (int i = 0; i < 7; ++i) {
+      values.push_back(reader.getvalue());
+    }
+    REQUIRE(values == std::vector<double>{1, 2, 3, 1, 2, 3, 1});
+  }
+
+  SECTION("recorded timing") {
+    ReaderOptions options;
+    options.replay_timing = true;
+    ReaderReplay reader(fname, options);
+    std::vector<double> values;
+    values.push_back(reader.getvalue());
+    values.push_back(reader.getvalue());
+    usleep(150000);
+    values.push_back(reader.getvalue());
+    usleep(100000);
+    values.push_back(reader.getvalue());
+    // starts over one average interval (100 ms) after the last sample
+    usleep(100000);
+    values.push_back(reader.getvalue());
+
+    REQUIRE(values == std::vector<double>{1, 1, 2, 3, 1});
+  }
+
+  SECTION("errors") {
+    REQUIRE_THROWS(ReaderReplay(TEST_BINARY_DIR "/does_not_exist.csv"));
+    std::filesystem::remove(fname);
+    outputstorage({}, fname);
+    REQUIRE_THROWS(ReaderReplay(fname));
+  }
+
+  std::filesystem::remove(fname);
+}
+
+TEST_CASE("simulated hwmon tree") {
+  const std::filesystem::path root(TEST_BINARY_DIR "/simulated_hwmon");
+
+  SECTION("tree layout") {
+    HwmonSimulator simulator(root, 2, std::chrono::milliseconds(1),
+                             SimulationPattern::constant);
+
+    auto attributes = simulator.attributes();
+    REQUIRE(attributes.size() == 12);
+    REQUIRE(std::filesystem::exists(root / "hwmon1" / "temp1_input"));
+    REQUIRE(ReaderSysfs(root / "hwmon0" / "temp1_input").getvalue() == 40000);
+    REQUIRE(ReaderLseek(root / "hwmon1" / "temp1_input").getvalue() == 41000);
+  }
+
+  SECTION("cleanup") {
+    REQUIRE(!std::filesystem::exists(root / "hwmon0"));
+  }
+
+  SECTION("values and types") {
+    HwmonSimulator simulator(root, 2, std::chrono::milliseconds(1),
+                             SimulationPattern::constant);
+    // neither a chip nor an attribute
+    std::filesystem::create_directories(root / "power");
+    std::ofstream(root / "hwmon0" / "temp1_label") << "Package\n";
+
+    auto attributes = scanHwmonTree(root, true);
+    REQUIRE(attributes.size() == 13);
+    // sorted by path: energy1, fan1, in0, power1, temp1_input, temp1_label
+    REQUIRE(attributes[4].full_path() == (root / "hwmon0" / "temp1_input").string());
+    REQUIRE(attributes[4].value == "40000");
+    REQUIRE(attributes[5].value == "Package");
+    REQUIRE(scanHwmonTree(root)[0].value.empty());
+
+    REQUIRE(hwmonAttributeType("temp1_input") == "temp");
+    REQUIRE(hwmonAttributeUnit("temp1_input") == "millidegree Celsius");
+    REQUIRE(hwmonAttributeUnit("energy1_input") == "microjoule");
+    REQUIRE(hwmonAttributeUnit("temp1_label").empty());
+    REQUIRE(hwmonAttributeUnit("in0_max_alarm").empty());
+
+    std::filesystem::remove_all(root / "power");
+    std::filesystem::remove(root / "hwmon0" / "temp1_label");
+  }
+
+  SECTION("values change") {
+    HwmonSimulator simulator(root, 1, std::chrono::milliseconds(1),
+                             SimulationPattern::step);
+    simulator.start();
+
+    time_reading_storage storage(2000);
+    ReaderLseek reader(root / "hwmon0" / "temp1_input");
+    for (auto& sample : storage) {
+      sample = {gettimestampnano(), reader.getvalue()};
+      usleep(20);
+    }
+    simulator.stop();
+
+    REQUIRE(simulator.updates() > 0);
+    REQUIRE(!getvalueduration(storage).empty());
+  }
+
+  SECTION("unknown pattern") {
+    REQUIRE_THROWS(parseSimulationPattern("zigzag"));
+  }
+}
+
+TEST_CASE("group snapshots") {
+  const std::filesystem::path chip(TEST_BINARY_DIR "/group_chip");
+  std::filesystem::remove_all(chip);
+  std::filesystem::create_directories(chip);
+  for (const auto& [name, value] : std::map<std::string, std::string>{
+           {"temp1_input", "42000"},
+           {"temp2_input", "43000"},
+           {"temp1_max", "90000"},
+           {"power1_input", "15000000"},
+           {"name", "chip"}}) {
+    std::ofstream(chip / name) << value << "\n";
+  }
+
+  SECTION("attribute selection") {
+    auto paths = selectGroupAttributes(chip, "temp*_input,power*");
+    REQUIRE(paths.size() == 3);
+    REQUIRE(paths[0].filename() == "power1_input");
+    REQUIRE(paths[2].filename() == "temp2_input");
+
+    REQUIRE_THROWS(selectGroupAttributes(chip, "fan*"));
+    REQUIRE_THROWS(selectGroupAttributes(chip / "missing", "*"));
+  }
+
+  SECTION("one row per snapshot") {
+    GroupReader reader(selectGroupAttributes(chip, "temp*_input,power*"));
+    GroupStorage storage(reader.size(), 5);
+    benchmarkGroup(reader, 5, storage);
+
+    REQUIRE(storage.column(0) == std::vector<double>(5, 15000000));
+    REQUIRE(storage.column(2) == std::vector<double>(5, 43000));
+    REQUIRE(std::is_sorted(storage.timestamps().begin(),
+                           storage.timestamps().end()));
+
+    const auto fname = chip / fname_group_snapshots;
+    storage.save(fname, reader.names());
+    std::ifstream file(fname);
+    std::string header;
+    std::getline(file, header);
+    REQUIRE(header == "nanoseconds,power1_input,temp1_input,temp2_input");
+    REQUIRE(countCsvRows(fname) == 5);
+  }
+
+  SECTION("errors") {
+    REQUIRE_THROWS(GroupReader({chip / "temp1_input", chip / "temp9_input"}));
+    std::ofstream(chip / "temp3_input").close();
+    GroupReader reader({chip / "temp3_input"});
+    REQUIRE_THROWS(reader.getvalue(0));
+  }
+
+  std::filesystem::remove_all(chip);
+}
+
+TEST_CASE("derived channel") {
+  SECTION("power from energy") {
+    REQUIRE(DerivedChannel::kindFor("/sys/class/hwmon/hwmon1/energy1_input") ==
+            DerivedKind::power);
+    DerivedChannel channel(DerivedKind::power);
+    REQUIRE(channel.columnName() == "power_w");
+
+    // 1 J per ms, read every 250 us
+    REQUIRE_FALSE(channel.push(0, 0));
+    REQUIRE_FALSE(channel.push(250000, 0));
+    // baseline, the update before it is unknown
+    REQUIRE_FALSE(channel.push(500000, 1000000));
+    REQUIRE_FALSE(channel.push(750000, 1000000));
+    REQUIRE(channel.push(1500000, 2000000));
+    REQUIRE(channel.push(2500000, 3000000));
+
+    REQUIRE(channel.samples().size() == 2);
+    REQUIRE(channel.samples()[0].first == 1500000);
+    REQUIRE(std::abs(channel.samples()[0].second - 1000) < 1e-9);
+    REQUIRE(std::abs(channel.samples()[1].second - 1000) < 1e-9);
+  }
+
+  SECTION("energy with wraparound") {
+    DerivedChannel channel(DerivedKind::power, 100000000);
+    channel.push(0, 80000000);
+    channel.push(1000000000, 90000000);
+    channel.push(2000000000, 95000000);
+    // 95 J -> 100 J = 0 J -> 5 J
+    channel.push(3000000000, 5000000);
+
+    REQUIRE(channel.wraps() == 1);
+    REQUIRE(channel.samples().size() == 2);
+    REQUIRE(std::abs(channel.samples()[0].second - 5) < 1e-9);
+    REQUIRE(std::abs(channel.samples()[1].second - 10) < 1e-9);
+  }
+
+  SECTION("energy reset without wrap value") {
+    DerivedChannel channel(DerivedKind::power);
+    channel.push(0, 10);
+    channel.push(1000, 20);
+    channel.push(2000, 5);
+    channel.push(3000, 15);
+    channel.push(4000, 25);
+
+    REQUIRE(channel.resets() == 1);
+    REQUIRE(channel.samples().size() == 1);
+    REQUIRE(channel.samples()[0].first == 4000);
+  }
+
+  SECTION("falling gauge") {
+    REQUIRE(DerivedChannel::kindFor("temp1_input") == DerivedKind::rate);
+    // a wrap value must not turn a drop into a wraparound
+    DerivedChannel channel(DerivedKind::rate, 100);
+    REQUIRE(channel.columnName() == "rate_per_s");
+    channel.push(0, 50);
+    channel.push(1000000000, 60);
+    channel.push(2000000000, 55);
+    channel.push(3000000000, 40);
+
+    REQUIRE(channel.wraps() == 0);
+    REQUIRE(channel.resets() == 0);
+    REQUIRE(channel.samples().size() == 2);
+    REQUIRE(std::abs(channel.samples()[0].second + 5) < 1e-9);
+    REQUIRE(std::abs(channel.samples()[1].second + 15) < 1e-9);
+  }
+}
+
+TEST_CASE("libsensors session") {
+  SECTION("shared while in use") {
+    auto session = LibsensorsSession::acquire();
+    REQUIRE(LibsensorsSession::acquire() == session);
+
+    std::weak_ptr<LibsensorsSession> released = session;
+    session.reset();
+    REQUIRE(released.expired());
+  }
+
+  SECTION("acquired and released by several threads") {
+    std::vector<std::thread> threads;
+    std::atomic<int> failures = 0;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < 50; ++i) {
+          auto session = LibsensorsSession::acquire();
+          for (const auto& sensor : session->list().sensors) {
+            try {
+              session->find(sensor.chip_path + "/" + sensor.subfeature_name);
+            } catch (const std::runtime_error&) {
+              ++failures;
+            }
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    REQUIRE(0 == failures);
+  }
+
+  SECTION("lookup by sysfs path") {
+    auto session = LibsensorsSession::acquire();
+    for (const auto& sensor : session->list().sensors) {
+      auto item = session->find(sensor.chip_path + "/" + sensor.subfeature_name);
+      REQUIRE(item.chip == sensor.chip_name);
+      REQUIRE(item.subfeature == sensor.subfeature_num);
+    }
+    REQUIRE_THROWS(session->find("/sys/class/hwmon/doesnotexist/temp1_input"));
+    REQUIRE_THROWS(ReaderLibsens("/sys/class/hwmon/doesnotexist/temp1_input"));
+  }
+}
+
+TEST_CASE("survey") {
+  const std::filesystem::path root(TEST_BINARY_DIR "/survey_hwmon");
+  std::filesystem::remove_all(root);
+  for (const auto& chip : {"hwmon0", "hwmon1", "hwmon2"}) {
+    std::filesystem::create_directories(root / chip);
+    std::ofstream(root / chip / "temp1_input") << "42000\n";
+  }
+  // hwmon1 and hwmon2 share a bus, hwmon0 has no device
+  std::filesystem::create_directories(root / "bus" / "dev1");
+  std::filesystem::create_directories(root / "bus" / "dev2");
+  std::filesystem::create_directory_symlink(root / "bus" / "dev1",
+                                            root / "hwmon1" / "device");
+  std::filesystem::create_directory_symlink(root / "bus" / "dev2",
+                                            root / "hwmon2" / "device");
+
+  SECTION("one sensor") {
+    const auto start = std::chrono::steady_clock::now();
+    auto result = surveySensor<ReaderLseek>(root / "hwmon0" / "temp1_input",
+                                            std::chrono::milliseconds(5));
+    // chunks end close to the budget
+    REQUIRE(std::chrono::steady_clock::now() - start <
+            std::chrono::milliseconds(500));
+    REQUIRE(result.error.empty());
+    REQUIRE(result.method == "lseek");
+    REQUIRE(result.accesses > 1);
+    REQUIRE(result.cost.median_ns > 0);
+    REQUIRE(result.changes == 0);
+    REQUIRE(result.update_interval_ns == 0);
+
+    auto missing = surveySensor<ReaderLseek>(root / "hwmon0" / "temp9_input",
+                                             std::chrono::milliseconds(5));
+    REQUIRE(!missing.error.empty());
+    REQUIRE(missing.accesses == 0);
+  }
+
+  SECTION("bus groups") {
+    REQUIRE(surveyBusKey(root / "hwmon0") == (root / "hwmon0").string());
+    REQUIRE(surveyBusKey(root / "hwmon1") == surveyBusKey(root / "hwmon2"));
+  }
+
+  SECTION("all sensors") {
+    auto results = survey(scanHwmonTree(root),
+                          {surveySensor<ReaderSysfs>, surveySensor<ReaderLseek>},
+                          std::chrono::milliseconds(2), 2);
+    REQUIRE(results.size() == 6);
+    REQUIRE(results[0].sensor == (root / "hwmon0" / "temp1_input").string());
+    REQUIRE(results[0].method == "lseek");
+    REQUIRE(results[1].method == "sysfs");
+    for (const auto& result : results) {
+      REQUIRE(result.error.empty());
+      REQUIRE(result.cpu >= 0);
+    }
+
+    std::stringstream csv;
+    outputSurvey(results, csv);
+    std::string header;
+    std::getline(csv, header);
+    REQUIRE(header == survey_csv_header());
+  }
+
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("reader plugins") {
+  const std::filesystem::path plugin_file(TEST_PLUGIN_DIR "/hwmondump_pread.so");
+
+  SECTION("method names") {
+    REQUIRE(PluginLibrary::isValidName("pread"));
+    REQUIRE(PluginLibrary::isValidName("bmc-bridge2"));
+    REQUIRE_FALSE(PluginLibrary::isValidName(""));
+    REQUIRE_FALSE(PluginLibrary::isValidName("my_method"));
+    REQUIRE_FALSE(PluginLibrary::isValidName("lseek"));
+  }
+
+  SECTION("load and read") {
+    std::list<PluginLibrary> loaded;
+    const auto& library = findPlugin("pread", loaded, {TEST_PLUGIN_DIR});
+    REQUIRE(loaded.size() == 1);
+    REQUIRE(std::string(library.plugin().name) == "pread");
+    // already loaded
+    findPlugin("pread", loaded, {});
+    REQUIRE(loaded.size() == 1);
+
+    static_assert(BatchReader<ReaderPlugin>);
+    ReaderOptions options;
+    REQUIRE(readerMethod<ReaderPlugin>(options) == "plugin");
+    REQUIRE_THROWS(ReaderPlugin(TEST_SOURCE_DIR "/test_file.txt", options));
+    options.plugin = &library.plugin();
+    REQUIRE(readerMethod<ReaderPlugin>(options) == "pread");
+    REQUIRE(readerMethod<ReaderShm<ReaderPlugin>>(options) == "pread");
+
+    ReaderPlugin reader(TEST_SOURCE_DIR "/test_file.txt", options);
+    REQUIRE(reader.getvalue() == 42);
+    time_reading_storage storage(10);
+    benchmarkNum(reader, 10, storage);
+    for (const auto& sample : storage) {
+      REQUIRE(sample.second == 42);
+    }
+    REQUIRE(std::is_sorted(storage.begin(), storage.end()));
+    REQUIRE(storage.front().first > 0);
+
+    REQUIRE_THROWS(ReaderPlugin("/does/not/exist", options));
+  }
+
+  SECTION("errors") {
+    std::list<PluginLibrary> loaded;
+    REQUIRE_THROWS(findPlugin("missing", loaded, {TEST_PLUGIN_DIR}));
+    REQUIRE_THROWS(PluginLibrary(TEST_SOURCE_DIR "/test_file.txt"));
+  }
+}
+
+TEST_CASE("c api") {
+  REQUIRE(hwmondump_api_version() == HWMONDUMP_API_VERSION);
+
+  SECTION("sampling and stats") {
+    hwmondump_reader* reader =
+        hwmondump_reader_open("lseek", TEST_SOURCE_DIR "/test_file.txt");
+    REQUIRE(reader != nullptr);
+    REQUIRE(std::string(hwmondump_reader_method(reader)) == "lseek");
+
+    double value = 0;
+    REQUIRE(hwmondump_read(reader, &value) == 0);
+    REQUIRE(value == 42);
+
+    std::vector<hwmondump_sample> samples(100);
+    REQUIRE(hwmondump_read_batch(reader, samples.data(), samples.size()) == 0);
+    REQUIRE(samples.back().value == 42);
+    REQUIRE(samples.front().timestamp_ns <= samples.back().timestamp_ns);
+
+    hwmondump_stats stats;
+    REQUIRE(hwmondump_compute_stats(samples.data(), samples.size(), &stats) == 0);
+    REQUIRE(stats.samples == 100);
+    REQUIRE(stats.changes == 0);
+    REQUIRE(stats.access_median_ns <= stats.access_max_ns);
+
+    REQUIRE(hwmondump_read_batch_rate(reader, samples.data(), 5, 1000) == 0);
+    REQUIRE(hwmondump_compute_stats(samples.data(), 5, &stats) == 0);
+    // 1 ms period
+    REQUIRE(stats.access_median_ns > 500000);
+
+    hwmondump_reader_close(reader);
+  }
+
+  SECTION("errors") {
+    REQUIRE(hwmondump_reader_open("nosuchmethod", "/does/not/exist") == nullptr);
+    REQUIRE(std::string(hwmondump_last_error()).find("nosuchmethod") !=
+            std::string::npos);
+
+    for (const char* method : {"lseek", "sysfs"}) {
+      REQUIRE(hwmondump_reader_open(method, "/does/not/exist") == nullptr);
+      REQUIRE_FALSE(std::string(hwmondump_last_error()).empty());
+    }
+
+    hwmondump_reader* reader =
+        hwmondump_reader_open("lseek", TEST_SOURCE_DIR "/test_file.txt");
+    REQUIRE(reader != nullptr);
+    REQUIRE(hwmondump_read_batch_rate(reader, nullptr, 0, 0) == -1);
+    hwmondump_reader_close(reader);
+    double value = 0;
+    REQUIRE(hwmondump_read(nullptr, &value) == -1);
+  }
+}
+
+TEST_CASE("shm ring") {
+  const std::string name = "hwmondump_test_" + std::to_string(getpid());
+
+  SECTION("publish and follow") {
+    ShmRingWriter writer(name, 5);
+    REQUIRE(writer.capacity() == 8);
+    REQUIRE_THROWS(ShmRingWriter(name, 8));
+    writer.setSource("lseek", "/some/sensor");
+    writer.push(1, 0.5);
+
+    ShmRingReader oldest(name, true);
+    ShmRingReader latest(name);
+    REQUIRE(oldest.method() == "lseek");
+    REQUIRE(oldest.sensor() == "/some/sensor");
+    REQUIRE(oldest.capacity() == 8);
+
+    writer.push(2, 1.5);
+    std::vector<ShmRingSample> samples;
+    REQUIRE(oldest.poll(samples) == 2);
+    REQUIRE(samples[0].sequence == 0);
+    REQUIRE(samples[0].timestamp == 1);
+    REQUIRE(samples[1].value == 1.5);
+    samples.clear();
+    REQUIRE(latest.poll(samples) == 1);
+    REQUIRE(samples[0].sequence == 1);
+    REQUIRE(latest.poll(samples) == 0);
+
+    // the producer never waits, slow consumers lose the oldest samples
+    for (int i = 0; i < 20; ++i) {
+      writer.push(10 + i, i);
+    }
+    samples.clear();
+    REQUIRE(latest.poll(samples, 3) == 3);
+    REQUIRE(latest.lost() == 12);
+    REQUIRE(samples.front().sequence == 14);
+    REQUIRE(latest.poll(samples) == 5);
+    REQUIRE(samples.back().value == 19);
+
+    REQUIRE_FALSE(latest.finished());
+    writer.finish();
+    REQUIRE(latest.finished());
+  }
+
+  SECTION("publishing reader") {
+    ShmRingWriter writer(name, 1024);
+    ShmRingReader ring(name);
+    ReaderOptions options;
+    options.shm_ring = &writer;
+    static_assert(BatchReader<ReaderShm<ReaderLseek>>);
+    static_assert(BatchReader<ReaderShm<ReaderLibsens>>);
+    static_assert(ReaderWithStats<ReaderShm<ReaderPoll>>);
+    REQUIRE(std::string(ReaderShm<ReaderLseek>::methodname()) == "lseek");
+
+    ReaderShm<ReaderLseek> reader(TEST_SOURCE_DIR "/test_file.txt", options);
+    REQUIRE(reader.getvalue() == 42);
+    time_reading_storage storage(100);
+    benchmarkNum(reader, 100, storage);
+
+    std::vector<ShmRingSample> samples;
+    REQUIRE(ring.poll(samples) == 101);
+    REQUIRE(ring.method() == "lseek");
+    for (size_t i = 0; i < storage.size(); ++i) {
+      REQUIRE(samples[i + 1].timestamp == storage[i].first);
+      REQUIRE(samples[i + 1].value == 42);
+    }
+  }
+
+  SECTION("errors") {
+    REQUIRE_THROWS(ShmRingReader(name));
+    REQUIRE_THROWS(ShmRingWriter(name, 1));
+    REQUIRE_THROWS(ShmRingWriter("a/b", 8));
+    REQUIRE_THROWS(ReaderShm<ReaderNull>("/dev/null", {}));
+  }
+}
+
+TEST_CASE("serve") {
+  const std::string test_file = TEST_SOURCE_DIR "/test_file.txt";
+
+  SECTION("sensor specs") {
+    auto sensor = parseServedSensor(test_file + "@50", 10);
+    REQUIRE(sensor.path == test_file);
+    REQUIRE(sensor.rate_hz == 50);
+    REQUIRE(parseServedSensor(test_file, 10).rate_hz == 10);
+    REQUIRE_THROWS(parseServedSensor(test_file + "@0", 10));
+    REQUIRE_THROWS(parseServedSensor(test_file + "@5x", 10));
+    REQUIRE_THROWS(parseServedSensor(test_file, 0));
+  }
+
+  SECTION("termination signals") {
+    sigset_t mask;
+    {
+      const TerminationSignals signals;
+      REQUIRE(sigismember(&signals.set(), SIGINT) == 1);
+      pthread_sigmask(SIG_BLOCK, nullptr, &mask);
+      REQUIRE(sigismember(&mask, SIGINT) == 1);
+      REQUIRE(sigismember(&mask, SIGTERM) == 1);
+    }
+    pthread_sigmask(SIG_BLOCK, nullptr, &mask);
+    REQUIRE(sigismember(&mask, SIGINT) == 0);
+    REQUIRE(sigismember(&mask, SIGTERM) == 0);
+  }
+
+  auto sensor = parseServedSensor(test_file + "@1000", 10);
+  attachCheapestServeReader(sensor, std::chrono::milliseconds(2));
+  REQUIRE((sensor.method == "lseek" || sensor.method == "sysfs"));
+  auto missing = parseServedSensor("/does/not/exist", 10);
+  attachServeReader<ReaderLseek>(missing);
+  REQUIRE_THROWS(attachCheapestServeReader(missing, std::chrono::milliseconds(1)));
+
+  SensorPoller poller({sensor, missing});
+
+  SECTION("responses") {
+    REQUIRE(poller.reading(0).value == 42);
+    REQUIRE(poller.reading(0).reads == 1);
+    REQUIRE(poller.reading(1).errors == 1);
+    REQUIRE(serveResponse(poller, "GET " + test_file)
+                .starts_with(test_file + " 42.000000 "));
+    REQUIRE(serveResponse(poller, "GET /does/not/exist").starts_with("ERR "));
+    REQUIRE(serveResponse(poller, "GET /other").starts_with("ERR "));
+    REQUIRE(serveResponse(poller, "NOPE").starts_with("ERR "));
+    REQUIRE(serveResponse(poller, "ALL").ends_with("\n\n"));
+    REQUIRE(serveResponse(poller, "LIST").starts_with(test_file + " " +
+                                                      sensor.method + " 1000 1 0\n"));
+  }
+
+  SECTION("polling") {
+    // wait for a number of reads instead of a time, a loaded machine may
+    // delay the poller arbitrarily
+    const auto start = std::chrono::steady_clock::now();
+    poller.start();
+    const auto deadline = start + std::chrono::seconds(10);
+    while (poller.reading(0).reads < 20 &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    poller.stop();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const auto reads = poller.reading(0).reads;
+    REQUIRE(reads >= 20);
+    // never faster than 1000 Hz, the constructor read once
+    REQUIRE(reads <= uint64_t(2 + elapsed / std::chrono::milliseconds(1)));
+    REQUIRE(poller.reading(1).reads == 0);
+  }
+
+  SECTION("failed start") {
+    const std::filesystem::path socket_path =
+        std::filesystem::temp_directory_path() /
+        ("hwmondump_test_" + std::to_string(getpid()) + ".sock");
+    // only the listening socket fits into the fd limit, epoll_create1 fails
+    const int next_fd = dup(0);
+    close(next_fd);
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    rlimit lowered = limit;
+    lowered.rlim_cur = next_fd + 1;
+    setrlimit(RLIMIT_NOFILE, &lowered);
+    REQUIRE_THROWS(ServeDaemon(poller, socket_path, 2));
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    // nothing is left behind, so the next start works
+    REQUIRE_FALSE(std::filesystem::exists(socket_path));
+    const int fd = dup(0);
+    close(fd);
+    REQUIRE(fd == next_fd);
+    ServeDaemon daemon(poller, socket_path, 2);
+  }
+
+  SECTION("socket") {
+    const std::filesystem::path socket_path =
+        std::filesystem::temp_directory_path() /
+        ("hwmondump_test_" + std::to_string(getpid()) + ".sock");
+    {
+      ServeDaemon daemon(poller, socket_path, 2);
+      REQUIRE_THROWS(ServeDaemon(poller, socket_path, 2));
+      std::thread server([&] { daemon.run(); });
+
+      // pipelined requests, answered in order
+      const auto response = serveQuery(
+          socket_path, "GET " + test_file + "\r\nLIST\nGET " + test_file + "\n");
+      std::stringstream lines(response);
+      std::string line;
+      std::getline(lines, line);
+      REQUIRE(line.starts_with(test_file + " 42.000000 "));
+      std::getline(lines, line);
+      REQUIRE(line.starts_with(test_file + " " + sensor.method));
+      std::getline(lines, line);
+      std::getline(lines, line);
+      REQUIRE(line.empty());
+      std::getline(lines, line);
+      REQUIRE(line.starts_with(test_file + " 42.000000 "));
+
+      // many clients, one after another
+      for (int i = 0; i < 20; ++i) {
+        REQUIRE(serveQuery(socket_path, "ALL\n").starts_with(test_file));
+      }
+      // oversized requests close the connection
+      REQUIRE(serveQuery(socket_path, std::string(10000, 'x')).empty());
+
+      // a client closing its sending side before reading more responses
+      // than fit into the socket does not keep the daemon busy
+      const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      sockaddr_un address = {};
+      address.sun_family = AF_UNIX;
+      strcpy(address.sun_path, socket_path.c_str());
+      REQUIRE(0 == connect(fd, reinterpret_cast<sockaddr*>(&address),
+                           sizeof(address)));
+      std::string requests;
+      for (int i = 0; i < 8000; ++i) {
+        requests += "LIST\n";
+      }
+      REQUIRE(send(fd, requests.data(), requests.size(), 0) ==
+              ssize_t(requests.size()));
+      shutdown(fd, SHUT_WR);
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      timespec cpu_start, cpu_end;
+      clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_start);
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_end);
+      REQUIRE((cpu_end.tv_sec - cpu_start.tv_sec) * 1000000000 +
+                  (cpu_end.tv_nsec - cpu_start.tv_nsec) <
+              50000000);
+      char buf[4096];
+      size_t received = 0;
+      for (ssize_t n; (n = recv(fd, buf, sizeof(buf), 0)) > 0;) {
+        received += n;
+      }
+      close(fd);
+      REQUIRE(received == 8000 * serveResponse(poller, "LIST").size());
+
+      daemon.stop();
+      server.join();
+      REQUIRE(daemon.connections() == 23);
+      REQUIRE(daemon.requests() == 8023);
+    }
+    REQUIRE_FALSE(std::filesystem::exists(socket_path));
+    REQUIRE_THROWS(serveQuery(socket_path, "ALL\n"));
+  }
+}
+
+TEST_CASE("watch") {
+  SECTION("output formatting") {
+    REQUIRE(jsonString("/sys/a") == "\"/sys/a\"");
+    REQUIRE(jsonString("a\"b\\c\n") == "\"a\\\"b\\\\c\\u000a\"");
+    REQUIRE(parseWatchFormat("json") == WatchFormat::json);
+    REQUIRE_THROWS(parseWatchFormat("xml"));
+  }
+
+  int fds[2];
+  REQUIRE(0 == pipe(fds));
+  std::vector<ServedSensor> sensors(2);
+  sensors[0].path = TEST_SOURCE_DIR "/test_file.txt";
+  sensors[1].path = "/does/not/exist";
+  attachServeReader<ReaderLseek>(sensors[0]);
+  attachServeReader<ReaderLseek>(sensors[1]);
+  sigset_t no_signals;
+  sigemptyset(&no_signals);
+  std::stringstream errors;
+
+  WatchOptions options{.rate_hz = 1000, .rounds = 5, .flush_interval_ns = 0};
+  SECTION("csv") {
+    const auto summary = watch(sensors, options, fds[1], no_signals, errors);
+    close(fds[1]);
+    REQUIRE(summary.rounds == 5);
+    REQUIRE(summary.samples == 5);
+    REQUIRE(summary.errors == 5);
+    REQUIRE(summary.lines == 5);
+    REQUIRE(summary.writes == 5);
+    REQUIRE(summary.usage.wall_s >= 0.004);
+    // reported once
+    const auto messages = errors.str();
+    REQUIRE(messages.starts_with("/does/not/exist: "));
+    REQUIRE(std::count(messages.begin(), messages.end(), '\n') == 1);
+
+    FILE* output = fdopen(fds[0], "r");
+    char line[256];
+    REQUIRE(fgets(line, sizeof(line), output));
+    REQUIRE(std::string(line) == "sensor,nanoseconds,value\n");
+    REQUIRE(fgets(line, sizeof(line), output));
+    REQUIRE(std::string(line).starts_with(TEST_SOURCE_DIR "/test_file.txt,"));
+    REQUIRE(std::string(line).ends_with(",42.000000\n"));
+    fclose(output);
+  }
+
+  SECTION("json with changes only") {
+    options.format = WatchFormat::json;
+    options.changes_only = true;
+    options.flush_interval_ns = 1000000000;
+    const auto summary = watch(sensors, options, fds[1], no_signals, errors);
+    close(fds[1]);
+    REQUIRE(summary.samples == 5);
+    REQUIRE(summary.lines == 1);
+    REQUIRE(summary.writes == 1);
+
+    FILE* output = fdopen(fds[0], "r");
+    char line[256];
+    REQUIRE(fgets(line, sizeof(line), output));
+    REQUIRE(std::string(line).starts_with(
+        "{\"sensor\":\"" TEST_SOURCE_DIR "/test_file.txt\",\"timestamp_ns\":"));
+    REQUIRE(std::string(line).ends_with(",\"value\":42.000000}\n"));
+    REQUIRE_FALSE(fgets(line, sizeof(line), output));
+    fclose(output);
+  }
+
+  SECTION("json without nan") {
+    options.format = WatchFormat::json;
+    options.rounds = 1;
+    sensors[0].read = [] { return std::nan(""); };
+    sensors[1].read = [] { return -HUGE_VAL; };
+    const auto summary = watch(sensors, options, fds[1], no_signals, errors);
+    close(fds[1]);
+    REQUIRE(summary.lines == 2);
+
+    FILE* output = fdopen(fds[0], "r");
+    char line[256];
+    for (int i = 0; i < 2; ++i) {
+      REQUIRE(fgets(line, sizeof(line), output));
+      REQUIRE(std::string(line).ends_with(",\"value\":null}\n"));
+    }
+    fclose(output);
+  }
+
+  SECTION("closed output") {
+    close(fds[0]);
+    signal(SIGPIPE, SIG_IGN);
+    options.rounds = 0;
+    const auto summary = watch(sensors, options, fds[1], no_signals, errors);
+    close(fds[1]);
+    REQUIRE(summary.rounds == 1);
+  }
+}
+
+TEST_CASE("online summary") {
+  SECTION("histogram buckets") {
+    for (uint64_t value : {0ull, 1ull, 63ull, 64ull, 65ull, 1000ull,
+                           123456789ull, ~0ull}) {
+      const auto bucket = LogLinearHistogram::bucketOf(value);
+      REQUIRE(bucket < LogLinearHistogram::bucket_count);
+      REQUIRE(LogLinearHistogram::lowerBound(bucket) <= value);
+      REQUIRE(LogLinearHistogram::upperBound(bucket) >= value);
+      // relative error below 1/32
+      REQUIRE(LogLinearHistogram::upperBound(bucket) -
+                  LogLinearHistogram::lowerBound(bucket) <=
+              value / 32);
+    }
+    REQUIRE(LogLinearHistogram::bucketOf(63) + 1 ==
+            LogLinearHistogram::bucketOf(64));
+  }
+
+  SECTION("quantiles") {
+    LogLinearHistogram histogram;
+    REQUIRE(histogram.quantile(0.5) == 0);
+    for (uint64_t value = 1; value <= 1000; ++value) {
+      histogram.record(value * 1000);
+    }
+    REQUIRE(histogram.count() == 1000);
+    REQUIRE(histogram.min() == 1000);
+    REQUIRE(histogram.max() == 1000000);
+    REQUIRE(histogram.mean() == 500500);
+    REQUIRE(histogram.quantile(0) == histogram.min());
+    REQUIRE(histogram.quantile(1) == histogram.max());
+    for (double quantile : {0.5, 0.9, 0.99}) {
+      const double exact = (1 + 1000 * quantile) * 1000;
+      REQUIRE(histogram.quantile(quantile) >= exact);
+      REQUIRE(histogram.quantile(quantile) <= exact * 33 / 32);
+    }
+  }
+
+  SECTION("matches the stored samples") {
+    time_reading_storage storage = {
+        {0, 1}, {10, 1}, {30, 2}, {60, 2}, {70, 3}, {100, 3}, {130, 3}};
+    OnlineSampleSummary summary;
+    for (const auto& [timestamp, value] : storage) {
+      summary.push(timestamp, value);
+    }
+
+    const auto latency = accessLatencies(storage);
+    REQUIRE(summary.samples() == 7);
+    REQUIRE(summary.runtime_ns() == 130);
+    REQUIRE(summary.access().quantile(0.5) == latency.median_ns);
+    REQUIRE(summary.access().max() == latency.max_ns);
+    REQUIRE(summary.access().mean() == latency.mean_ns);
+    REQUIRE(summary.changes() == 2);
+
+    // same durations as getvalueduration()
+    LogLinearHistogram expected;
+    for (const auto& [duration, value] : getvalueduration(storage)) {
+      expected.record(duration);
+    }
+    const auto durations = summary.valueDuration();
+    REQUIRE(durations.count() == expected.count());
+    REQUIRE(durations.min() == expected.min());
+    REQUIRE(durations.max() == expected.max());
+
+    const auto map = summary.toMap();
+    REQUIRE(map.at("value_min") == 1);
+    REQUIRE(map.at("access_max_ns") == 30);
+    REQUIRE(map.at("value_max") == 3);
+    REQUIRE(map.at("changes") == 2);
+  }
+
+  SECTION("gaps") {
+    OnlineSampleSummary summary;
+    summary.push(0, 1);
+    summary.push(10, 1);
+    summary.gap();
+    summary.push(1000, 2);
+    summary.push(1020, 2);
+
+    REQUIRE(summary.samples() == 4);
+    REQUIRE(summary.access().count() == 2);
+    REQUIRE(summary.access().max() == 20);
+    REQUIRE(summary.changes() == 1);
+    REQUIRE(summary.runtime_ns() == 1020);
+  }
+
+  SECTION("benchmark without storage") {
+    OnlineSampleSummary summary;
+    PhaseTimer phases;
+    MeasurementHooks hooks;
+    hooks.phases = &phases;
+    REQUIRE(runbenchSummary<ReaderLseek>(10000, 0,
+                                         TEST_SOURCE_DIR "/test_file.txt",
+                                         summary, hooks) == 10000);
+    REQUIRE(summary.samples() == 10000);
+    // chunks hold at most 4096 samples, intervals between them are skipped
+    REQUIRE(summary.access().count() <= 9997);
+    REQUIRE(summary.changes() == 0);
+    REQUIRE(summary.toMap().at("value_mean") == 42);
+    REQUIRE(phases.phases().back().name == "measurement");
+
+    OnlineSampleSummary timed;
+    REQUIRE(runbenchSummary<ReaderNull>(0, 50000000, "/dev/null", timed) > 0);
+    REQUIRE(timed.runtime_ns() >= 50000000);
+
+    const auto path = std::filesystem::temp_directory_path() /
+                      ("hwmondump_histogram_" + std::to_string(getpid()));
+    summary.save(path);
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    REQUIRE(line == "histogram,lower_ns,upper_ns,count");
+    uint64_t total = 0;
+    while (std::getline(file, line)) {
+      REQUIRE(line.starts_with("access,"));
+      total += std::stoull(line.substr(line.rfind(',') + 1));
+    }
+    REQUIRE(total == summary.access().count());
+    std::filesystem::remove(path);
+  }
+}